@@ -16,16 +16,21 @@
 
 /*
  * Create program for the given script file. Invokes the parser.
+ * The script text is hashed if \p hash is true.
  *
  * \return instance or NULL on error
  */
 static SAU_Program *build_program(const char *restrict script_arg,
-		bool is_path) {
-	SAU_Script *sd = SAU_load_Script(script_arg, is_path);
+		bool is_path, bool hash) {
+	uint64_t script_hash = 0;
+	SAU_Script *sd = SAU_load_Script(script_arg, is_path,
+			hash ? &script_hash : NULL);
 	if (!sd)
 		return NULL;
 	SAU_Program *o = SAU_build_Program(sd);
 	SAU_discard_Script(sd);
+	if (o != NULL)
+		o->script_hash = script_hash;
 	return o;
 }
 
@@ -38,10 +43,11 @@ static SAU_Program *build_program(const char *restrict script_arg,
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
 		SAU_PtrArr *restrict prg_objs) {
 	bool are_paths = !(options & SAU_ARG_EVAL_STRING);
+	bool hash = (options & SAU_ARG_SCRIPT_HASH) != 0;
 	size_t built = 0;
 	const char **args = (const char**) SAU_PtrArr_ITEMS(script_args);
 	for (size_t i = 0; i < script_args->count; ++i) {
-		SAU_Program *prg = build_program(args[i], are_paths);
+		SAU_Program *prg = build_program(args[i], are_paths, hash);
 		if (prg != NULL) ++built;
 		SAU_PtrArr_add(prg_objs, prg);
 	}
@@ -392,6 +392,15 @@ static SAU_Program *ScriptConv_create_program(ScriptConv *restrict o,
 		 */
 		prg->mode |= SAU_PMODE_AMP_DIV_VOICES;
 	}
+	if (script->sopt.changed & SAU_SOPT_CTL_RAMPS) {
+		/*
+		 * Fill ramps at control rate where possible, or not,
+		 * overriding the default chosen by the audio generator.
+		 */
+		prg->mode |= SAU_PMODE_CTL_RAMPS_SET;
+		if (script->sopt.ctl_ramps)
+			prg->mode |= SAU_PMODE_CTL_RAMPS;
+	}
 	prg->vo_count = o->va.count;
 	prg->op_count = o->oa.count;
 	prg->duration_ms = o->duration_ms;
@@ -78,6 +78,19 @@ void *SAU_memdup(const void *restrict src, size_t size) {
 	return dst;
 }
 
+/**
+ * Continue 64-bit FNV-1a hash \p h over \p len bytes of \p data.
+ * Begin with SAU_FNV_OFFSET for \p h.
+ *
+ * \return new hash value
+ */
+uint64_t SAU_hash_fnv1a(uint64_t h, const void *restrict data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; ++i)
+		h = (h ^ bytes[i]) * SAU_FNV_PRIME;
+	return h;
+}
+
 /**
  * Command-line argument parser similar to POSIX getopt(),
  * but replacing opt* global variables with \p opt fields.
@@ -29,12 +29,14 @@
  */
 
 #if defined(__GNUC__) || defined(__clang__)
+# define sauAlwaysInline inline __attribute__((always_inline))
 # define sauMalloclike __attribute__((malloc))
 # define sauMaybeUnused __attribute__((unused))
 # define sauNoinline __attribute__((noinline))
 # define sauPrintflike(string_index, first_to_check) \
 	__attribute__((format(printf, string_index, first_to_check)))
 #else
+# define sauAlwaysInline inline
 # define sauMalloclike
 # define sauMaybeUnused
 # define sauNoinline
@@ -54,6 +56,12 @@
 /** Is \p c a visible non-whitespace 7-bit ASCII character? */
 #define SAU_IS_ASCIIVISIBLE(c) ((c) >= '!' && (c) <= '~')
 
+/** Initial value for 64-bit FNV-1a hashing. */
+#define SAU_FNV_OFFSET 14695981039346656037ULL
+
+/** Multiplier for 64-bit FNV-1a hashing. */
+#define SAU_FNV_PRIME  1099511628211ULL
+
 /*
  * Utility functions.
  */
@@ -65,6 +73,8 @@ void SAU_error(const char *restrict label, const char *restrict fmt, ...)
 
 void *SAU_memdup(const void *restrict src, size_t size) sauMalloclike;
 
+uint64_t SAU_hash_fnv1a(uint64_t h, const void *restrict data, size_t len);
+
 /** SAU_getopt() data. Initialize to zero, except \a err for error messages. */
 struct SAU_opt {
 	int ind; /* set to zero to start over next SAU_getopt() call */
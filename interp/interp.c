@@ -15,25 +15,321 @@
 #include "prealloc.h"
 #include "mixer.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #define BUF_LEN SAU_MIX_BUFLEN
 typedef float Buf[BUF_LEN];
 
+/*
+ * Maximum number of operators gathered for running as a sine bank.
+ */
+#define BANK_MAX 64
+
+/*
+ * Operators gathered for running together with SAU_Osc_run_sin_bank().
+ */
+typedef struct OpBank {
+	uint32_t count;
+	bool skip; /* only advance phases, output unused */
+	SAU_Osc *oscs[BANK_MAX];
+	float freqs[BANK_MAX], amps[BANK_MAX];
+} OpBank;
+
+/*
+ * Run state for a schedule node, during one run of a voice.
+ */
+typedef struct RunFrame {
+	uint32_t pos; /* position in block of start of buffers */
+	uint32_t len; /* after silence and time limit */
+	uint32_t zero_len, skip_len;
+	uint32_t osc_flags;
+	uint32_t acc_ind;
+	uint32_t pm_acc; /* count of accumulated PM outputs */
+	uint32_t kept_len; /* length of output kept for re-use, if any */
+	uint32_t kept_acc_ind; /* acc_ind for parent when output kept */
+	bool parent_freq_const;
+	bool pm_bank; /* run eligible PM modulators as sine bank */
+	bool skip_osc; /* only advance phase, output unused */
+} RunFrame;
+
+struct RunTask;
+
+/*
+ * Buffers and state used for running voices, one set per thread.
+ *
+ * With worker threads, each set also has tasks, for running the
+ * subtrees of a modulator list in parallel, and a set of its own
+ * for each. The tasks are taken by the thread, and any thread
+ * otherwise idle, while holding the task lock of the set; each
+ * set has its own, so that threads only contend for the same
+ * lock when taking tasks from the same list.
+ */
+typedef struct RunScratch {
+	Buf *bufs;
+	RunFrame *frames;
+	OpBank *banks;
+	SAU_Mixer *mixer; /* for voice output, set before running voices */
+	struct RunTask *tasks;
+	pthread_mutex_t task_lock;
+	pthread_cond_t task_wait; /* signalled when the last task is done */
+	const RunSchedule *task_sched;
+	uint32_t task_count, task_next, task_done;
+} RunScratch;
+
+/*
+ * Modulator subtree run as a task, into its own set of buffers.
+ * The output is afterwards combined with that of the others
+ * in the list, in order, like when running them in turn.
+ */
+typedef struct RunTask {
+	RunScratch rs;
+	uint32_t step; /* first step, for the root of the subtree */
+	uint32_t acc_ind; /* for combining output */
+} RunTask;
+
+/*
+ * Number of voices run per batch and thread, when using worker
+ * threads. Each voice in a batch has its own mixer slot.
+ */
+#define BATCH_PER_THREAD 32
+
+/*
+ * Worker threads, which together with the calling thread run the
+ * voices playing in batches. Each voice is mixed into its own slot,
+ * the slots then added up in the order of voices, so that the result
+ * is the same as when running the voices one by one into one mixer.
+ * Both are split between threads, the latter by parts of the block.
+ *
+ * Threads also take tasks from each other while otherwise waiting.
+ * The lock is only held for starting and finishing batches, and for
+ * sleeping when there's nothing to do; voices are taken using a lock
+ * of their own, and tasks using those of the scratch sets.
+ */
+typedef struct Workers {
+	pthread_mutex_t lock;
+	pthread_cond_t wake; /* broadcast to idle threads on each change */
+	pthread_mutex_t take_lock; /* for taking voices, using next */
+	pthread_t *threads;
+	uint32_t count; /* threads created, besides the calling thread */
+	uint32_t task_locks; /* scratch sets with task lock initialized */
+	uint32_t changes; /* incremented on each change waited for */
+	uint32_t idle;  /* threads waiting for a change */
+	uint32_t batch; /* incremented for each batch started */
+	uint32_t rendering; /* threads not yet done running voices */
+	uint32_t busy;  /* threads not yet done with batch */
+	bool quit;
+	uint32_t first, next; /* of batch in voices playing */
+	uint32_t voice_count, slot_count;
+	uint32_t len;
+	SAU_Mixer **slots;
+	uint32_t *slot_lens;
+} Workers;
+
+/*
+ * Argument for worker thread.
+ */
+typedef struct WorkerArg {
+	struct SAU_Interp *o;
+	uint32_t id; /* scratch set to use */
+} WorkerArg;
+
+/*
+ * Snapshot of the mutable state at a sample position, the operator,
+ * voice, and playing voice data held in the arrays of the index.
+ */
+typedef struct IndexSnap {
+	size_t pos;
+	size_t event;
+	uint32_t event_pos;
+	uint16_t active_count;
+} IndexSnap;
+
+/*
+ * Snapshots recorded every \a interval samples while running, up to
+ * \a max, for SAU_Interp_seek(). When full, every other snapshot is
+ * dropped and the interval doubled, keeping the memory used bounded.
+ */
+typedef struct Index {
+	size_t interval;
+	size_t next_pos; /* for next snapshot, after those recorded */
+	uint32_t count, max;
+	IndexSnap *snaps;
+	OperatorNode *operators; /* op_count per snapshot */
+	VoiceNode *voices; /* vo_count per snapshot */
+	uint16_t *active; /* vo_count per snapshot */
+} Index;
+
 struct SAU_Interp {
 	const SAU_Program *prg;
 	uint32_t srate;
+	uint32_t osc_flags;
+	SAU_Ramp_run_f ramp_run;
+	bool skip; /* only advance state, for SAU_Interp_skip() */
+	size_t pos; /* samples run or skipped since start */
 	uint32_t buf_count;
-	Buf *bufs;
+	uint32_t thread_count;
+	RunScratch *scratch; /* one per thread */
+	Workers *workers; /* if more than one thread */
 	SAU_Mixer *mixer;
+	Index *index; /* if enabled with SAU_Interp_set_index() */
 	size_t event, ev_count;
 	EventNode **events;
 	uint32_t event_pos;
-	uint16_t voice, vo_count;
+	uint16_t vo_count;
+	uint16_t active_count;
+	uint16_t *active; /* IDs of voices playing, in ascending order */
 	VoiceNode *voices;
 	OperatorNode *operators;
+	uint32_t op_count;
 	SAU_MemPool *mem;
 };
 
+static void *run_worker(void *arg);
+
+/*
+ * Count a change waited for, and wake any idle threads.
+ * Call with the lock of the workers held.
+ */
+static void notify_workers(Workers *restrict w) {
+	++w->changes;
+	if (w->idle > 0)
+		pthread_cond_broadcast(&w->wake);
+}
+
+/*
+ * Create worker threads and mixer slots for them, the mixers
+ * using \p scale. No more slots are made than \p max_active,
+ * the peak number of voices playing at once.
+ *
+ * \return true, or false on failure
+ */
+static bool init_workers(SAU_Interp *restrict o, float scale,
+		uint32_t max_active) {
+	Workers *w = SAU_MemPool_alloc(o->mem, sizeof(Workers));
+	if (!w)
+		return false;
+	uint32_t slot_count = o->thread_count * BATCH_PER_THREAD;
+	if (slot_count > max_active)
+		slot_count = (max_active > 0) ? max_active : 1;
+	w->slots = SAU_MemPool_alloc(o->mem,
+			slot_count * sizeof(*w->slots));
+	w->slot_lens = SAU_MemPool_alloc(o->mem,
+			slot_count * sizeof(*w->slot_lens));
+	w->threads = SAU_MemPool_alloc(o->mem,
+			(o->thread_count - 1) * sizeof(*w->threads));
+	WorkerArg *args = SAU_MemPool_alloc(o->mem,
+			(o->thread_count - 1) * sizeof(*args));
+	if (!w->slots || !w->slot_lens || !w->threads || !args)
+		return false;
+	if (pthread_mutex_init(&w->lock, NULL) != 0)
+		return false;
+	if (pthread_cond_init(&w->wake, NULL) != 0) {
+		pthread_mutex_destroy(&w->lock);
+		return false;
+	}
+	if (pthread_mutex_init(&w->take_lock, NULL) != 0) {
+		pthread_cond_destroy(&w->wake);
+		pthread_mutex_destroy(&w->lock);
+		return false;
+	}
+	o->workers = w; /* cleaned up by fini_workers() from here */
+	for (uint32_t i = 0; i < o->thread_count; ++i) {
+		RunScratch *rs = &o->scratch[i];
+		if (pthread_mutex_init(&rs->task_lock, NULL) != 0)
+			return false;
+		if (pthread_cond_init(&rs->task_wait, NULL) != 0) {
+			pthread_mutex_destroy(&rs->task_lock);
+			return false;
+		}
+		++w->task_locks;
+	}
+	for (uint32_t i = 0; i < slot_count; ++i) {
+		w->slots[i] = SAU_create_Mixer();
+		if (!w->slots[i])
+			return false;
+		SAU_Mixer_set_scale(w->slots[i], scale);
+		++w->slot_count;
+	}
+	for (uint32_t i = 0; i < o->thread_count - 1; ++i) {
+		args[i] = (WorkerArg){o, i + 1};
+		if (pthread_create(&w->threads[i], NULL,
+					run_worker, &args[i]) != 0) {
+			SAU_error("interp", "failed to create thread");
+			return false;
+		}
+		++w->count;
+	}
+	return true;
+}
+
+/*
+ * Stop and join worker threads, and free their mixer slots.
+ */
+static void fini_workers(SAU_Interp *restrict o) {
+	Workers *w = o->workers;
+	if (!w) {
+		return;
+	}
+	pthread_mutex_lock(&w->lock);
+	w->quit = true;
+	notify_workers(w);
+	pthread_mutex_unlock(&w->lock);
+	for (uint32_t i = 0; i < w->count; ++i)
+		pthread_join(w->threads[i], NULL);
+	for (uint32_t i = 0; i < w->task_locks; ++i) {
+		RunScratch *rs = &o->scratch[i];
+		pthread_cond_destroy(&rs->task_wait);
+		pthread_mutex_destroy(&rs->task_lock);
+	}
+	pthread_mutex_destroy(&w->take_lock);
+	pthread_cond_destroy(&w->wake);
+	pthread_mutex_destroy(&w->lock);
+	for (uint32_t i = 0; i < w->slot_count; ++i)
+		SAU_destroy_Mixer(w->slots[i]);
+}
+
+/*
+ * Free snapshot index, if any.
+ */
+static void fini_index(SAU_Interp *restrict o) {
+	Index *x = o->index;
+	if (!x)
+		return;
+	free(x->snaps);
+	free(x->operators);
+	free(x->voices);
+	free(x->active);
+	free(x);
+	o->index = NULL;
+}
+
+/*
+ * Allocate buffers and state in \p rs for running voices,
+ * sized using \p pa.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool init_scratch(SAU_Interp *restrict o, RunScratch *restrict rs,
+		const SAU_PreAlloc *restrict pa) {
+	if (pa->max_bufs > 0) {
+		rs->bufs = SAU_MemPool_alloc(o->mem,
+				pa->max_bufs * sizeof(Buf));
+		if (!rs->bufs) return false;
+	}
+	if (pa->max_nodes > 0) {
+		rs->frames = SAU_MemPool_alloc(o->mem,
+				pa->max_nodes * sizeof(*rs->frames));
+		if (!rs->frames) return false;
+		/* one for carriers, one per level for PM modulators */
+		rs->banks = SAU_MemPool_alloc(o->mem,
+				(pa->vg.nest_max + 2) * sizeof(*rs->banks));
+		if (!rs->banks) return false;
+	}
+	return true;
+}
+
 static bool init_for_program(SAU_Interp *restrict o,
 		const SAU_Program *restrict prg, uint32_t srate) {
 	SAU_PreAlloc pa;
@@ -41,35 +337,69 @@ static bool init_for_program(SAU_Interp *restrict o,
 		return false;
 	o->prg = prg;
 	o->srate = srate;
+	if ((prg->mode & SAU_PMODE_CTL_RAMPS_SET) != 0)
+		o->ramp_run = ((prg->mode & SAU_PMODE_CTL_RAMPS) != 0) ?
+			SAU_Ramp_run_ctl :
+			SAU_Ramp_run;
 	o->events = pa.events;
 	o->ev_count = pa.ev_count;
 	o->operators = pa.operators;
+	o->op_count = pa.op_count;
 	o->voices = pa.voices;
 	o->vo_count = pa.vo_count;
-	if (pa.max_bufs > 0) {
-		o->bufs = SAU_MemPool_alloc(o->mem,
-				pa.max_bufs * sizeof(Buf));
-		if (!o->bufs) goto ERROR;
-		o->buf_count = pa.max_bufs;
+	/*
+	 * Threads are only of use with several voices at once,
+	 * or subtrees to run in parallel.
+	 */
+	if (pa.max_active <= 1 && pa.max_tasks == 0)
+		o->thread_count = 1;
+	if (pa.vo_count > 0) {
+		o->active = SAU_MemPool_alloc(o->mem,
+				pa.vo_count * sizeof(*o->active));
+		if (!o->active) goto ERROR;
 	}
+	o->scratch = SAU_MemPool_alloc(o->mem,
+			o->thread_count * sizeof(RunScratch));
+	if (!o->scratch) goto ERROR;
+	for (uint32_t i = 0; i < o->thread_count; ++i) {
+		RunScratch *rs = &o->scratch[i];
+		if (!init_scratch(o, rs, &pa)) goto ERROR;
+		if (o->thread_count == 1 || pa.max_tasks == 0)
+			continue;
+		rs->tasks = SAU_MemPool_alloc(o->mem,
+				pa.max_tasks * sizeof(*rs->tasks));
+		if (!rs->tasks) goto ERROR;
+		for (uint32_t j = 0; j < pa.max_tasks; ++j)
+			if (!init_scratch(o, &rs->tasks[j].rs, &pa))
+				goto ERROR;
+	}
+	o->buf_count = pa.max_bufs;
 	o->mixer = SAU_create_Mixer();
 	if (!o->mixer) goto ERROR;
 
 	float scale = 1.f;
 	if ((prg->mode & SAU_PMODE_AMP_DIV_VOICES) != 0)
 		scale /= o->vo_count;
-	SAU_Mixer_set_srate(o->mixer, srate);
 	SAU_Mixer_set_scale(o->mixer, scale);
+	if (o->thread_count > 1 &&
+	    !init_workers(o, scale, pa.max_active)) goto ERROR;
 	return true;
 ERROR:
 	return false;
 }
 
 /**
- * Create instance for program \p prg and sample rate \p srate.
+ * Create instance for program \p prg and sample rate \p srate,
+ * with option \p flags (SAU_INTERP_*).
+ *
+ * Voices are run using \p threads threads, the calling thread
+ * and workers; if 0 or 1, only the calling thread is used. The
+ * output is the same regardless of the number. No more threads
+ * than SAU_INTERP_THREADS_MAX are used, and no workers unless the
+ * program plays several voices at once or has subtrees to split.
  */
 SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) {
+		uint32_t srate, uint32_t flags, uint32_t threads) {
 	SAU_MemPool *mem = SAU_create_MemPool(0);
 	if (!mem)
 		return NULL;
@@ -79,11 +409,20 @@ SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
 		return NULL;
 	}
 	o->mem = mem;
+	if ((flags & SAU_INTERP_POLYBLEP) != 0)
+		o->osc_flags |= SAU_OSC_POLYBLEP;
+	o->ramp_run = ((flags & SAU_INTERP_CTL_RAMPS) != 0) ?
+		SAU_Ramp_run_ctl :
+		SAU_Ramp_run;
+	if (threads > SAU_INTERP_THREADS_MAX)
+		threads = SAU_INTERP_THREADS_MAX;
+	o->thread_count = (threads > 1) ? threads : 1;
+	SAU_global_init_Osc();
+	SAU_global_init_Ramp();
 	if (!init_for_program(o, prg, srate)) {
 		SAU_destroy_Interp(o);
 		return NULL;
 	}
-	SAU_global_init_Wave();
 	return o;
 }
 
@@ -93,6 +432,8 @@ SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
 void SAU_destroy_Interp(SAU_Interp *restrict o) {
 	if (!o)
 		return;
+	fini_workers(o);
+	fini_index(o);
 	SAU_destroy_Mixer(o->mixer);
 	SAU_destroy_MemPool(o->mem);
 }
@@ -113,16 +454,29 @@ static void set_voice_duration(SAU_Interp *restrict o,
 	vn->duration = time;
 }
 
+/*
+ * Add voice \p vo_id to those playing, keeping them in the order
+ * of voice ID, which is the order run and mixed in.
+ */
+static void activate_voice(SAU_Interp *restrict o, uint16_t vo_id) {
+	uint16_t *active = o->active;
+	uint32_t i = o->active_count++;
+	for (; i > 0 && active[i - 1] > vo_id; --i)
+		active[i] = active[i - 1];
+	active[i] = vo_id;
+	o->voices[vo_id].flags |= VN_ACTIVE;
+}
+
 /*
  * Process an event update for a ramp parameter.
  */
 static void handle_ramp_update(SAU_Ramp *restrict ramp,
 		uint32_t *restrict ramp_pos,
-		const SAU_Ramp *restrict ramp_src) {
+		const SAU_Ramp *restrict ramp_src, uint32_t srate) {
 	if ((ramp_src->flags & SAU_RAMPP_GOAL) != 0) {
 		*ramp_pos = 0;
 	}
-	SAU_Ramp_copy(ramp, ramp_src);
+	SAU_Ramp_copy(ramp, ramp_src, srate);
 }
 
 /*
@@ -145,7 +499,7 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 			on->pmods = od->pmods;
 			on->amods = od->amods;
 			if (params & SAU_POPP_WAVE)
-				on->osc.lut = SAU_Osc_LUT(od->wave);
+				SAU_Osc_set_wave(&on->osc, od->wave);
 			if (params & SAU_POPP_TIME) {
 				const SAU_Time *src = &od->time;
 				if (src->flags & SAU_TIMEP_LINKED) {
@@ -162,18 +516,22 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 						o->srate);
 			if (params & SAU_POPP_FREQ)
 				handle_ramp_update(&on->freq,
-						&on->freq_pos, &od->freq);
+						&on->freq_pos, &od->freq,
+						o->srate);
 			if (params & SAU_POPP_FREQ2)
 				handle_ramp_update(&on->freq2,
-						&on->freq2_pos, &od->freq2);
+						&on->freq2_pos, &od->freq2,
+						o->srate);
 			if (params & SAU_POPP_PHASE)
 				on->osc.phase = SAU_Osc_PHASE(od->phase);
 			if (params & SAU_POPP_AMP)
 				handle_ramp_update(&on->amp,
-						&on->amp_pos, &od->amp);
+						&on->amp_pos, &od->amp,
+						o->srate);
 			if (params & SAU_POPP_AMP2)
 				handle_ramp_update(&on->amp2,
-						&on->amp2_pos, &od->amp2);
+						&on->amp2_pos, &od->amp2,
+						o->srate);
 		}
 		if (prg_e->vo_id != SAU_PVO_NO_ID) {
 			const SAU_ProgramVoData *vd = prg_e->vo_data;
@@ -182,223 +540,901 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 			if (e->graph != NULL) {
 				vn->graph = e->graph;
 				vn->graph_count = e->graph_count;
+				vn->sched = e->sched;
 			}
 			if (params & SAU_PVOP_PAN)
 				handle_ramp_update(&vn->pan,
-						&vn->pan_pos, &vd->pan);
+						&vn->pan_pos, &vd->pan,
+						o->srate);
 			vn->flags |= VN_INIT;
-			vn->pos = 0;
-			if (o->voice > prg_e->vo_id) {
-				/* go back to re-activated node */
-				o->voice = prg_e->vo_id;
-			}
 			set_voice_duration(o, vn);
+			if (vn->duration != 0 && !(vn->flags & VN_ACTIVE))
+				activate_voice(o, prg_e->vo_id);
 		}
 	}
 }
 
 /*
- * Generate up to buf_len samples for an operator node,
- * the remainder (if any) zero-filled if acc_ind is zero.
+ * Check whether an operator node can be run as part of a sine bank
+ * for \p len samples; it must be a sine with held frequency and
+ * amplitude, no modulators, and nothing limiting its length. A
+ * frequency relative to the parent's is only allowed if
+ * \p parent_freq_const is true, as when running it normally.
+ */
+static bool bank_eligible(const OperatorNode *restrict n,
+		uint32_t len, bool parent_freq_const) {
+	if (n->osc.wave != SAU_WAVE_SIN || n->silence != 0)
+		return false;
+	if (n->fmods->count > 0 || n->pmods->count > 0 ||
+	    n->amods->count > 0)
+		return false;
+	if (n->time < len && !(n->flags & ON_TIME_INF))
+		return false;
+	if (!SAU_Ramp_HELD(&n->freq) || (!parent_freq_const &&
+	    (n->freq.flags & SAU_RAMPP_STATE_RATIO) != 0))
+		return false;
+	return SAU_Ramp_HELD(&n->amp);
+}
+
+/*
+ * Add operator node to sine bank for a run of \p len samples,
+ * updating its state like running it normally does.
+ */
+static void bank_add(OpBank *restrict b,
+		OperatorNode *restrict n, uint32_t len,
+		float *restrict parent_freq) {
+	uint32_t i = b->count++;
+	b->oscs[i] = &n->osc;
+	SAU_Ramp_run(&n->freq, &n->freq_pos,
+			&b->freqs[i], 1, parent_freq);
+	SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len);
+	SAU_Ramp_run(&n->amp, &n->amp_pos,
+			&b->amps[i], 1, NULL);
+	SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len);
+	if (!(n->flags & ON_TIME_INF))
+		n->time -= len;
+}
+
+/*
+ * Run any operators in sine bank, into \p buf for \p len samples,
+ * and empty it. Only advances their phases if marked to skip.
  *
- * Recursively visits the subnodes of the operator node,
- * if any.
+ * \return 1 if run, as a count of accumulated outputs, else 0
+ */
+static uint32_t bank_flush(OpBank *restrict b,
+		float *restrict buf, uint32_t len, uint32_t acc_ind) {
+	if (b->count == 0)
+		return 0;
+	if (b->skip) {
+		for (uint32_t i = 0; i < b->count; ++i)
+			SAU_Osc_skip(b->oscs[i], len, &b->freqs[i],
+					SAU_OSC_FREQ_CONST);
+	} else {
+		SAU_Osc_run_sin_bank(b->oscs, b->count, buf, len,
+				acc_ind, b->freqs, b->amps);
+	}
+	b->count = 0;
+	return 1;
+}
+
+/*
+ * Check whether the frequency of an operator node depends on that
+ * of the parent, so that its output can only be re-used for the
+ * same parent frequency.
+ */
+static inline bool freq_relative(const OperatorNode *restrict n) {
+	const uint8_t ratio = SAU_RAMPP_STATE_RATIO | SAU_RAMPP_GOAL_RATIO;
+	return ((n->freq.flags | n->freq2.flags) & ratio) != 0;
+}
+
+/*
+ * Put modulator output kept by node \p fn, in \p out, into \p s_buf, for
+ * \p len samples from \p pos in the block, accumulating like
+ * running the modulator with \p acc_ind does. Only the part
+ * generated is accumulated, not the silence before or the
+ * zero-filled rest.
+ */
+static void put_output(float *restrict s_buf, const float *restrict out,
+		const RunNode *restrict fn, const RunFrame *restrict ff,
+		uint32_t pos, uint32_t len, uint32_t acc_ind) {
+	const uint32_t d = pos - ff->pos;
+	uint32_t j;
+	out += d;
+	if (!acc_ind) {
+		memcpy(s_buf, out, len * sizeof(float));
+		return;
+	}
+	uint32_t start = ff->zero_len, end = ff->zero_len + ff->len;
+	start = (start > d) ? start - d : 0;
+	end = (end > d) ? end - d : 0;
+	if (end > len)
+		end = len;
+	if (fn->use == SAU_POP_PMOD) {
+		for (j = start; j < end; ++j)
+			s_buf[j] += out[j];
+	} else {
+		for (j = start; j < end; ++j)
+			s_buf[j] *= out[j];
+	}
+}
+
+/*
+ * Check whether modulator output kept by node \p fn can be used for
+ * \p len samples from \p pos in the block, with \p parent_freq.
+ */
+static bool can_reuse(Buf *restrict bufs,
+		const RunNode *restrict fn, const RunFrame *restrict ff,
+		const OperatorNode *restrict n,
+		uint32_t pos, uint32_t len,
+		const float *restrict parent_freq) {
+	if (pos < ff->pos || pos + len > ff->pos + ff->kept_len)
+		return false;
+	if (!freq_relative(n))
+		return true;
+	return fn->key != 0 &&
+		!memcmp(bufs[fn->key] + (pos - ff->pos), parent_freq,
+				len * sizeof(float));
+}
+
+/*
+ * Finish the run of a node keeping its output for re-use, the
+ * \p run_len samples generated, putting it into the parent's buffer.
+ */
+static void keep_output(Buf *restrict bufs,
+		const RunNode *restrict rn, RunFrame *restrict f,
+		uint32_t run_len) {
+	f->len = run_len;
+	put_output(bufs[rn->s_buf], bufs[rn->out], rn, f,
+			f->pos, f->kept_len, f->kept_acc_ind);
+}
+
+static uint32_t run_schedule(SAU_Interp *restrict o,
+		RunScratch *restrict rs,
+		const RunSchedule *restrict sched,
+		uint32_t first, uint32_t time);
+
+/*
+ * Run a task not yet taken, from those of scratch set \p id if any,
+ * else from those of another. Call without the lock of the workers
+ * held; only the task lock of each set looked at is taken, and not
+ * while running the task.
  *
- * Returns number of samples generated for the node.
+ * \return true if a task was run
  */
-static uint32_t run_block(SAU_Interp *restrict o,
-		Buf *restrict bufs, uint32_t buf_len,
-		OperatorNode *restrict n,
-		float *restrict parent_freq,
-		bool wave_env, uint32_t acc_ind) {
-	uint32_t i, len = buf_len;
-	float *s_buf = *(bufs++), *pm_buf;
-	float *freq, *amp;
-	/*
-	 * If silence, zero-fill and delay processing for duration.
-	 */
-	uint32_t zero_len = 0;
-	if (n->silence) {
-		zero_len = n->silence;
-		if (zero_len > len)
-			zero_len = len;
-		if (!acc_ind) for (i = 0; i < zero_len; ++i)
-			s_buf[i] = 0;
-		len -= zero_len;
-		if (!(n->flags & ON_TIME_INF)) n->time -= zero_len;
-		n->silence -= zero_len;
-		if (!len)
-			return zero_len;
-		s_buf += zero_len;
+static bool run_task(SAU_Interp *restrict o, uint32_t id) {
+	for (uint32_t i = 0; i < o->thread_count; ++i) {
+		RunScratch *rs = &o->scratch[(id + i) % o->thread_count];
+		pthread_mutex_lock(&rs->task_lock);
+		if (rs->task_next >= rs->task_count) {
+			pthread_mutex_unlock(&rs->task_lock);
+			continue;
+		}
+		RunTask *t = &rs->tasks[rs->task_next++];
+		const RunSchedule *sched = rs->task_sched;
+		pthread_mutex_unlock(&rs->task_lock);
+		run_schedule(o, &t->rs, sched, t->step, 0);
+		pthread_mutex_lock(&rs->task_lock);
+		if (++rs->task_done == rs->task_count)
+			pthread_cond_signal(&rs->task_wait);
+		pthread_mutex_unlock(&rs->task_lock);
+		return true;
 	}
-	/*
-	 * Guard against circular references.
-	 */
-	if ((n->flags & ON_VISITED) != 0) {
-		for (i = 0; i < len; ++i)
-			s_buf[i] = 0;
-		return zero_len + len;
+	return false;
+}
+
+/*
+ * Wait for a change to the workers, running a task instead if there
+ * is one. Call with the lock of the workers held, in a loop checking
+ * for the change; the lock is released while running a task.
+ */
+static void wait_workers(SAU_Interp *restrict o, uint32_t id) {
+	Workers *w = o->workers;
+	uint32_t changes = w->changes;
+	pthread_mutex_unlock(&w->lock);
+	bool ran = run_task(o, id);
+	pthread_mutex_lock(&w->lock);
+	if (ran || w->changes != changes)
+		return;
+	++w->idle;
+	pthread_cond_wait(&w->wake, &w->lock);
+	--w->idle;
+}
+
+/*
+ * Run the modulator list beginning at step \p i, each subtree as a
+ * task, taken by this and any idle threads. The parent's frame and
+ * frequency are copied for each. After all are done, the output is
+ * combined in list order, the same as when running them in turn.
+ *
+ * \return index of step following the list
+ */
+static uint32_t run_tasks(SAU_Interp *restrict o,
+		RunScratch *restrict rs,
+		const RunSchedule *restrict sched, uint32_t i) {
+	Workers *w = o->workers;
+	const RunNode *nodes = sched->nodes;
+	const uint32_t parent = nodes[sched->steps[i].node].parent;
+	const RunNode *pn = &nodes[parent];
+	RunFrame *pf = &rs->frames[parent];
+	const float *parent_freq = rs->bufs[pn->freq];
+	uint32_t count = 0, k;
+	while (sched->steps[i].node != parent) {
+		const RunNode *rn = &nodes[sched->steps[i].node];
+		RunTask *t = &rs->tasks[count++];
+		t->step = i;
+		t->acc_ind = (rn->use != SAU_POP_PMOD) ?
+			rn->list_ind :
+			pf->pm_acc++;
+		t->rs.frames[parent] = *pf;
+		memcpy(t->rs.bufs[pn->freq], parent_freq,
+				pf->len * sizeof(float));
+		i = rn->end;
 	}
-	n->flags |= ON_VISITED;
+	uint32_t id = rs - o->scratch;
+	pthread_mutex_lock(&rs->task_lock);
+	rs->task_sched = sched;
+	rs->task_count = count;
+	rs->task_next = 0;
+	rs->task_done = 0;
+	pthread_mutex_unlock(&rs->task_lock);
+	pthread_mutex_lock(&w->lock);
+	notify_workers(w);
+	pthread_mutex_unlock(&w->lock);
 	/*
-	 * Limit length to time duration of operator.
+	 * Run tasks, own ones first, until all own ones are taken,
+	 * then wait for those taken by others to be done.
 	 */
-	uint32_t skip_len = 0;
-	if (n->time < len && !(n->flags & ON_TIME_INF)) {
-		skip_len = len - n->time;
-		len = n->time;
+	while (run_task(o, id)) ;
+	pthread_mutex_lock(&rs->task_lock);
+	while (rs->task_done < count)
+		pthread_cond_wait(&rs->task_wait, &rs->task_lock);
+	rs->task_count = 0;
+	pthread_mutex_unlock(&rs->task_lock);
+	for (k = 0; k < count; ++k) {
+		const RunTask *t = &rs->tasks[k];
+		uint32_t node = sched->steps[t->step].node;
+		const RunNode *rn = &nodes[node];
+		const RunFrame *tf = &t->rs.frames[node];
+		put_output(rs->bufs[rn->s_buf], t->rs.bufs[rn->s_buf],
+				rn, tf, tf->pos, pf->len, t->acc_ind);
 	}
+	return i;
+}
+
+/*
+ * Generate up to \p time samples for the operators of a voice, by
+ * running the steps of its schedule in turn, the carriers' output
+ * accumulated in the first buffer. If \p first is non-zero, only
+ * the subtree of modulators starting with it is run, as a task,
+ * its output not accumulated.
+ *
+ * For each operator node, the remainder (if any) of the length is
+ * zero-filled if its output isn't accumulated on top of other output.
+ * Modulators are run for the length left for the operator they
+ * modulate, from their own position in the buffers. A modulator
+ * with several users is only run again if the output it gave
+ * can't be re-used, which requires the same parent frequency if
+ * relative to it, and enough length.
+ *
+ * Modulator lists marked for it are run with their subtrees as
+ * tasks, in parallel, if there's worker threads. Otherwise, they
+ * are run serially, but without sine banks, for the same result.
+ *
+ * When skipping, only the output of FM modulators, and what they
+ * in turn use, is generated; other oscillators are only advanced.
+ *
+ * \return number of samples generated
+ */
+static uint32_t run_schedule(SAU_Interp *restrict o,
+		RunScratch *restrict rs,
+		const RunSchedule *restrict sched,
+		uint32_t first, uint32_t time) {
+	const RunNode *nodes = sched->nodes;
+	RunFrame *frames = rs->frames;
+	Buf *bufs = rs->bufs;
+	uint32_t out_len = 0, acc_ind = 0;
+	uint32_t i, end = sched->step_count;
+	uint32_t root = RUN_NO_PARENT;
 	/*
-	 * Handle frequency, including frequency modulation
-	 * if modulators linked.
+	 * Carriers simple enough are run together as sine banks,
+	 * if there's enough of them.
 	 */
-	freq = *(bufs++);
-	SAU_Ramp_run(&n->freq, &n->freq_pos, freq, len, o->srate, parent_freq);
-	if (n->fmods->count > 0) {
-		float *freq2 = *(bufs++);
-		SAU_Ramp_run(&n->freq2, &n->freq2_pos,
-				freq2, len, o->srate, parent_freq);
-		const uint32_t *fmods = n->fmods->ids;
-		for (i = 0; i < n->fmods->count; ++i)
-			run_block(o, bufs, len, &o->operators[fmods[i]],
-					freq, true, i);
-		float *fm_buf = *bufs;
-		for (i = 0; i < len; ++i)
-			freq[i] += (freq2[i] - freq[i]) * fm_buf[i];
-	} else {
-		SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len, o->srate);
+	uint32_t bank_count = 0;
+	if (first > 0) {
+		root = sched->steps[first].node;
+		end = nodes[root].end;
+	} else for (i = 0; i < sched->node_count; ++i) {
+		frames[i].kept_len = 0;
+		if (nodes[i].parent != RUN_NO_PARENT) continue;
+		OperatorNode *n = &o->operators[nodes[i].op_id];
+		if (n->time != 0 && bank_eligible(n, time, true))
+			++bank_count;
 	}
-	/*
-	 * If phase modulators linked, get phase offsets for modulation.
-	 */
-	pm_buf = NULL;
-	if (n->pmods->count > 0) {
-		const uint32_t *pmods = n->pmods->ids;
-		for (i = 0; i < n->pmods->count; ++i)
-			run_block(o, bufs, len, &o->operators[pmods[i]],
-					freq, false, i);
-		pm_buf = *(bufs++);
+	OpBank *carr_bank = &rs->banks[0];
+	carr_bank->count = 0;
+	carr_bank->skip = o->skip;
+	for (i = first; i < end; ) {
+		const RunStep step = sched->steps[i++];
+		const RunNode *rn = &nodes[step.node];
+		RunFrame *f = &frames[step.node];
+		OperatorNode *n = &o->operators[rn->op_id];
+		const RunNode *pn = NULL;
+		RunFrame *pf = NULL;
+		float *parent_freq = NULL;
+		if (rn->parent != RUN_NO_PARENT) {
+			pn = &nodes[rn->parent];
+			pf = &frames[rn->parent];
+			parent_freq = bufs[pn->freq];
+		}
+		float *s_buf = bufs[rn->out ? rn->out : rn->s_buf];
+		float *freq = bufs[rn->freq], *amp = bufs[rn->amp];
+		uint32_t j, len;
+		switch (step.type) {
+		case RUN_BEGIN:
+			f->skip_osc = pn ?
+				(pf->skip_osc && rn->use != SAU_POP_FMOD) :
+				o->skip;
+			if (!pn) {
+				len = time;
+				f->pos = 0;
+				f->parent_freq_const = true;
+				if (n->time == 0) {
+					i = rn->end;
+					continue;
+				}
+				if (bank_count >= SAU_Osc_BANK_MIN &&
+				    bank_eligible(n, len, true)) {
+					bank_add(carr_bank, n, len, NULL);
+					if (carr_bank->count == BANK_MAX)
+						acc_ind += bank_flush(carr_bank,
+								s_buf, len,
+								acc_ind);
+					if (len > out_len) out_len = len;
+					i = rn->end;
+					continue;
+				}
+				f->acc_ind = acc_ind++;
+			} else {
+				len = pf->len;
+				f->pos = pf->pos + pf->zero_len;
+				/*
+				 * Re-use output of modulator if possible.
+				 */
+				const RunNode *fn = &nodes[rn->first];
+				const RunFrame *ff = &frames[rn->first];
+				if (fn != rn && can_reuse(bufs, fn, ff, n,
+						f->pos, len, parent_freq)) {
+					put_output(s_buf, bufs[fn->out], fn, ff,
+							f->pos, len,
+							(rn->use != SAU_POP_PMOD) ?
+							rn->list_ind :
+							pf->pm_acc++);
+					i = rn->end;
+					continue;
+				}
+				f->parent_freq_const = (rn->use != SAU_POP_FMOD) &&
+					(pf->osc_flags & SAU_OSC_FREQ_CONST);
+				if (rn->use != SAU_POP_PMOD) {
+					f->acc_ind = rn->list_ind;
+				} else if (pf->pm_bank && fn == rn && !rn->out &&
+						bank_eligible(n, len,
+						f->parent_freq_const)) {
+					OpBank *b = &rs->banks[1 + pn->level];
+					bank_add(b, n, len, parent_freq);
+					if (b->count == BANK_MAX)
+						pf->pm_acc += bank_flush(b,
+								s_buf, len,
+								pf->pm_acc);
+					i = rn->end;
+					continue;
+				} else {
+					f->acc_ind = pf->pm_acc++;
+				}
+				if (step.node == root) {
+					/*
+					 * Run as task, output combined later.
+					 */
+					f->acc_ind = 0;
+				} else if (rn->out) {
+					/*
+					 * Keep output for re-use, run
+					 * into own buffer.
+					 */
+					f->kept_len = len;
+					f->kept_acc_ind = f->acc_ind;
+					f->acc_ind = 0;
+					if (rn->key && freq_relative(n))
+						memcpy(bufs[rn->key], parent_freq,
+							len * sizeof(float));
+				}
+			}
+			/*
+			 * If silence, zero-fill and delay processing for duration.
+			 */
+			f->zero_len = 0;
+			if (n->silence) {
+				uint32_t zero_len = n->silence;
+				if (zero_len > len)
+					zero_len = len;
+				if (!f->acc_ind) for (j = 0; j < zero_len; ++j)
+					s_buf[j] = 0;
+				len -= zero_len;
+				if (!(n->flags & ON_TIME_INF))
+					n->time -= zero_len;
+				n->silence -= zero_len;
+				f->zero_len = zero_len;
+				if (!len) {
+					f->len = 0;
+					if (!pn && zero_len > out_len)
+						out_len = zero_len;
+					if (rn->out)
+						keep_output(bufs, rn, f, 0);
+					i = rn->end;
+					continue;
+				}
+				s_buf += zero_len;
+			}
+			/*
+			 * Output nothing for circular references.
+			 */
+			if (rn->circular) {
+				for (j = 0; j < len; ++j)
+					s_buf[j] = 0;
+				continue;
+			}
+			/*
+			 * Limit length to time duration of operator.
+			 */
+			f->skip_len = 0;
+			if (n->time < len && !(n->flags & ON_TIME_INF)) {
+				f->skip_len = len - n->time;
+				len = n->time;
+			}
+			f->len = len;
+			f->osc_flags = o->osc_flags;
+			/*
+			 * Get frequency values for frequency modulation,
+			 * if modulators linked.
+			 */
+			if (n->fmods->count > 0) {
+				o->ramp_run(&n->freq, &n->freq_pos,
+						freq, len, parent_freq);
+				o->ramp_run(&n->freq2, &n->freq2_pos,
+						bufs[rn->freq2], len, parent_freq);
+			}
+			break;
+		case RUN_FREQ:
+			len = f->len;
+			/*
+			 * Handle frequency, including frequency modulation
+			 * if modulators linked.
+			 */
+			if (n->fmods->count > 0) {
+				float *freq2 = bufs[rn->freq2];
+				float *fm_buf = bufs[rn->fm];
+				for (j = 0; j < len; ++j)
+					freq[j] += (freq2[j] - freq[j]) *
+						fm_buf[j];
+			} else {
+				uint32_t freq_len = len;
+				if (SAU_Ramp_HELD(&n->freq) &&
+				    (f->parent_freq_const || !(n->freq.flags &
+				     SAU_RAMPP_STATE_RATIO))) {
+					f->osc_flags |= SAU_OSC_FREQ_CONST;
+					/* only modulators need the value repeated */
+					if (!n->pmods->count && !n->amods->count)
+						freq_len = 1;
+				}
+				o->ramp_run(&n->freq, &n->freq_pos,
+						freq, freq_len, parent_freq);
+				SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len);
+			}
+			/*
+			 * Prepare for phase modulators, if linked, those
+			 * simple enough run together as sine banks if
+			 * there's enough of them, unless run as tasks.
+			 */
+			if (n->pmods->count > 0) {
+				const uint32_t *pmods = n->pmods->ids;
+				const bool freq_const =
+					f->osc_flags & SAU_OSC_FREQ_CONST;
+				const bool as_tasks =
+					rn->par_uses & (1 << SAU_POP_PMOD);
+				uint32_t pm_bank_count = 0;
+				for (j = 0; j < n->pmods->count; ++j)
+					if (bank_eligible(&o->operators[pmods[j]],
+							len, freq_const))
+						++pm_bank_count;
+				f->pm_bank = !as_tasks &&
+					(pm_bank_count >= SAU_Osc_BANK_MIN);
+				f->pm_acc = 0;
+				rs->banks[1 + rn->level].count = 0;
+				rs->banks[1 + rn->level].skip = f->skip_osc;
+			}
+			break;
+		case RUN_AMP:
+			len = f->len;
+			if (n->pmods->count > 0)
+				bank_flush(&rs->banks[1 + rn->level],
+						bufs[rn->pm], len, f->pm_acc);
+			/*
+			 * Handle amplitude parameter, including amplitude
+			 * modulation if modulators linked. Only advanced if
+			 * skipping generating output.
+			 */
+			if (f->skip_osc) {
+				SAU_Ramp_skip(&n->amp, &n->amp_pos, len);
+				SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len);
+			} else if (n->amods->count > 0) {
+				o->ramp_run(&n->amp, &n->amp_pos,
+						amp, len, NULL);
+				o->ramp_run(&n->amp2, &n->amp2_pos,
+						bufs[rn->amp2], len, NULL);
+			} else {
+				uint32_t amp_len = len;
+				if (SAU_Ramp_HELD(&n->amp)) {
+					f->osc_flags |= SAU_OSC_AMP_CONST;
+					amp_len = 1;
+				}
+				o->ramp_run(&n->amp, &n->amp_pos,
+						amp, amp_len, NULL);
+				SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len);
+			}
+			break;
+		case RUN_OSC:
+			len = f->len;
+			if (n->amods->count > 0 && !f->skip_osc) {
+				float *amp2 = bufs[rn->amp2];
+				float *am_buf = bufs[rn->am];
+				for (j = 0; j < len; ++j)
+					amp[j] += (amp2[j] - amp[j]) * am_buf[j];
+			}
+			float *pm_buf = (n->pmods->count > 0) ?
+				bufs[rn->pm] : NULL;
+			s_buf += f->zero_len;
+			if (f->skip_osc) {
+				SAU_Osc_skip(&n->osc, len, freq, f->osc_flags);
+			} else if (rn->use == SAU_POP_CARR ||
+			    rn->use == SAU_POP_PMOD) {
+				SAU_Osc_run(&n->osc, s_buf, len, f->acc_ind,
+						freq, amp, pm_buf, f->osc_flags);
+			} else {
+				SAU_Osc_run_env(&n->osc, s_buf, len, f->acc_ind,
+						freq, amp, pm_buf, f->osc_flags);
+			}
+			/*
+			 * Update time duration left, zero rest of buffer
+			 * if unfilled.
+			 */
+			if (!(n->flags & ON_TIME_INF)) {
+				if (!f->acc_ind && f->skip_len > 0) {
+					s_buf += len;
+					for (j = 0; j < f->skip_len; ++j)
+						s_buf[j] = 0;
+				}
+				n->time -= len;
+			}
+			if (!pn && f->zero_len + len > out_len)
+				out_len = f->zero_len + len;
+			if (rn->out)
+				keep_output(bufs, rn, f, len);
+			break;
+		}
+		/*
+		 * Run modulator list following step as tasks, if
+		 * marked for it and there's worker threads.
+		 */
+		if (rn->par_uses != 0 && rs->tasks != NULL && i < end) {
+			const RunStep next = sched->steps[i];
+			const RunNode *mn = &nodes[next.node];
+			if (mn->parent == step.node &&
+			    (rn->par_uses & (1 << mn->use)) != 0)
+				i = run_tasks(o, rs, sched, i);
+		}
 	}
-	/*
-	 * Handle amplitude parameter, including amplitude modulation if
-	 * modulators linked.
-	 */
-	amp = *(bufs++);
-	SAU_Ramp_run(&n->amp, &n->amp_pos, amp, len, o->srate, NULL);
-	if (n->amods->count > 0) {
-		float *amp2 = *(bufs++);
-		SAU_Ramp_run(&n->amp2, &n->amp2_pos, amp2, len, o->srate, NULL);
-		const uint32_t *amods = n->amods->ids;
-		for (i = 0; i < n->amods->count; ++i)
-			run_block(o, bufs, len, &o->operators[amods[i]],
-					freq, true, i);
-		float *am_buf = *bufs;
-		for (i = 0; i < len; ++i)
-			amp[i] += (amp2[i] - amp[i]) * am_buf[i];
-	} else {
-		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len, o->srate);
+	bank_flush(carr_bank, bufs[0], time, acc_ind);
+	return out_len;
+}
+
+/*
+ * Check whether an operator node can be run straight into the mix
+ * buffers using run_block_mix(), as a carrier without modulators.
+ */
+static bool mix_eligible(const OperatorNode *restrict n) {
+	if (n->silence != 0)
+		return false;
+	return (n->fmods->count == 0 && n->pmods->count == 0 &&
+		n->amods->count == 0);
+}
+
+/*
+ * Generate up to buf_len samples for a carrier operator node without
+ * modulators, adding them into the mix buffers panned using \p pan,
+ * which must be held. Fuses what run_schedule() and SAU_Mixer_add()
+ * do for such a node, the oscillator output never stored in a buffer.
+ *
+ * \return number of samples generated for the node
+ */
+static uint32_t run_block_mix(SAU_Interp *restrict o,
+		RunScratch *restrict rs,
+		uint32_t buf_len, OperatorNode *restrict n,
+		const SAU_Ramp *restrict pan) {
+	uint32_t len = buf_len;
+	if (n->time < len && !(n->flags & ON_TIME_INF))
+		len = n->time;
+	uint32_t osc_flags = o->osc_flags;
+	float *freq = rs->bufs[0], *amp = rs->bufs[1];
+	uint32_t freq_len = len, amp_len = len;
+	if (SAU_Ramp_HELD(&n->freq)) {
+		osc_flags |= SAU_OSC_FREQ_CONST;
+		freq_len = 1;
 	}
-	if (!wave_env) {
-		SAU_Osc_run(&n->osc, s_buf, len, acc_ind, freq, amp, pm_buf);
+	o->ramp_run(&n->freq, &n->freq_pos, freq, freq_len, NULL);
+	SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len);
+	if (o->skip) {
+		SAU_Ramp_skip(&n->amp, &n->amp_pos, len);
+		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len);
+		SAU_Osc_skip(&n->osc, len, freq, osc_flags);
 	} else {
-		SAU_Osc_run_env(&n->osc, s_buf, len, acc_ind, freq, amp, pm_buf);
-	}
-	/*
-	 * Update time duration left, zero rest of buffer if unfilled.
-	 */
-	if (!(n->flags & ON_TIME_INF)) {
-		if (!acc_ind && skip_len > 0) {
-			s_buf += len;
-			for (i = 0; i < skip_len; ++i)
-				s_buf[i] = 0;
+		if (SAU_Ramp_HELD(&n->amp)) {
+			osc_flags |= SAU_OSC_AMP_CONST;
+			amp_len = 1;
 		}
-		n->time -= len;
+		o->ramp_run(&n->amp, &n->amp_pos, amp, amp_len, NULL);
+		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len);
+		SAU_Mixer_add_osc(rs->mixer, &n->osc, len,
+				freq, amp, osc_flags, pan);
 	}
-	n->flags &= ~ON_VISITED;
-	return zero_len + len;
+	if (!(n->flags & ON_TIME_INF))
+		n->time -= len;
+	return len;
 }
 
 /*
  * Generate up to BUF_LEN samples for a voice, mixed into the
- * mix buffers.
+ * mix buffers of the mixer of \p rs.
  *
  * \return number of samples generated
  */
 static uint32_t run_voice(SAU_Interp *restrict o,
+		RunScratch *restrict rs,
 		VoiceNode *restrict vn, uint32_t len) {
 	uint32_t out_len = 0;
 	const SAU_ProgramOpRef *ops = vn->graph;
 	uint32_t opc = vn->graph_count;
 	if (!ops)
 		return 0;
-	uint32_t acc_ind = 0;
 	uint32_t time;
-	uint32_t i;
 	time = vn->duration;
 	if (len > BUF_LEN) len = BUF_LEN;
 	if (time > len) time = len;
-	for (i = 0; i < opc; ++i) {
-		uint32_t last_len;
-		// TODO: finish redesign
-		if (ops[i].use != SAU_POP_CARR) continue;
-		OperatorNode *n = &o->operators[ops[i].id];
-		if (n->time == 0) continue;
-		last_len = run_block(o, o->bufs, time, n,
-				NULL, false, acc_ind++);
-		if (last_len > out_len) out_len = last_len;
+	/*
+	 * A lone carrier without modulators, with pan held, is run
+	 * straight into the mix buffers.
+	 */
+	if (opc == 1 && ops[0].use == SAU_POP_CARR &&
+	    SAU_Ramp_HELD(&vn->pan)) {
+		OperatorNode *n = &o->operators[ops[0].id];
+		if (mix_eligible(n)) {
+			if (n->time != 0)
+				out_len = run_block_mix(o, rs, time, n,
+						&vn->pan);
+			goto DONE;
+		}
 	}
+	out_len = run_schedule(o, rs, &vn->sched, 0, time);
 	if (out_len > 0) {
-		SAU_Mixer_add(o->mixer, o->bufs[0], out_len,
-				&vn->pan, &vn->pan_pos);
+		if (o->skip)
+			SAU_Ramp_skip(&vn->pan, &vn->pan_pos, out_len);
+		else
+			SAU_Mixer_add(rs->mixer, rs->bufs[0], out_len,
+					&vn->pan, &vn->pan_pos);
 	}
+DONE:
 	vn->duration -= time;
-	vn->pos += time;
 	return out_len;
 }
 
+/*
+ * Run the current batch as thread \p id (0 for the calling thread),
+ * taking voices one at a time until none are left, using scratch
+ * set \p id. Then, after all threads are done with the voices, add
+ * up the mixer slots for the part of the block for \p id.
+ */
+static void run_batch(SAU_Interp *restrict o, uint32_t id) {
+	Workers *w = o->workers;
+	RunScratch *rs = &o->scratch[id];
+	uint32_t i;
+	for (;;) {
+		pthread_mutex_lock(&w->take_lock);
+		i = w->next++;
+		pthread_mutex_unlock(&w->take_lock);
+		if (i >= w->voice_count)
+			break;
+		VoiceNode *vn = &o->voices[o->active[w->first + i]];
+		uint32_t voice_len = 0;
+		if (vn->duration != 0) {
+			rs->mixer = w->slots[i];
+			if (!o->skip)
+				SAU_Mixer_clear(rs->mixer);
+			voice_len = run_voice(o, rs, vn, w->len);
+		}
+		w->slot_lens[i] = voice_len;
+	}
+	pthread_mutex_lock(&w->lock);
+	if (--w->rendering == 0)
+		notify_workers(w);
+	while (w->rendering > 0)
+		wait_workers(o, id);
+	pthread_mutex_unlock(&w->lock);
+	if (o->skip)
+		return;
+	/*
+	 * Mix part, in multiples of 16 samples.
+	 */
+	uint32_t part = (w->len + o->thread_count - 1) / o->thread_count;
+	part = (part + 15) & ~15U;
+	uint32_t pos = id * part, end = pos + part;
+	if (end > w->len)
+		end = w->len;
+	for (i = 0; i < w->voice_count; ++i) {
+		uint32_t voice_end = w->slot_lens[i];
+		if (voice_end > end)
+			voice_end = end;
+		if (voice_end > pos)
+			SAU_Mixer_add_mix(o->mixer, w->slots[i],
+					pos, voice_end - pos);
+	}
+}
+
+/*
+ * Worker thread main function. Waits for each batch to
+ * be started, and runs voices of it, running tasks of
+ * other threads in the meantime.
+ */
+static void *run_worker(void *arg) {
+	const WorkerArg *wa = arg;
+	SAU_Interp *o = wa->o;
+	Workers *w = o->workers;
+	uint32_t batch = 0;
+	pthread_mutex_lock(&w->lock);
+	while (!w->quit) {
+		if (w->batch != batch) {
+			batch = w->batch;
+			pthread_mutex_unlock(&w->lock);
+			run_batch(o, wa->id);
+			pthread_mutex_lock(&w->lock);
+			if (--w->busy == 0)
+				notify_workers(w);
+			continue;
+		}
+		wait_workers(o, wa->id);
+	}
+	pthread_mutex_unlock(&w->lock);
+	return NULL;
+}
+
+/*
+ * Run the voices playing for \p len samples using the worker
+ * threads together with the calling thread, in batches of as
+ * many voices as there are mixer slots.
+ *
+ * \return number of samples generated
+ */
+static uint32_t run_batches(SAU_Interp *restrict o, uint32_t len) {
+	Workers *w = o->workers;
+	uint32_t last_len = 0;
+	for (uint32_t first = 0; first < o->active_count;
+			first += w->slot_count) {
+		uint32_t count = o->active_count - first;
+		if (count > w->slot_count)
+			count = w->slot_count;
+		pthread_mutex_lock(&w->lock);
+		w->first = first;
+		w->next = 0;
+		w->voice_count = count;
+		w->len = len;
+		w->rendering = w->count + 1;
+		w->busy = w->count;
+		++w->batch;
+		notify_workers(w);
+		pthread_mutex_unlock(&w->lock);
+		run_batch(o, 0);
+		pthread_mutex_lock(&w->lock);
+		while (w->busy > 0)
+			wait_workers(o, 0);
+		pthread_mutex_unlock(&w->lock);
+		for (uint32_t i = 0; i < count; ++i) {
+			if (w->slot_lens[i] > last_len)
+				last_len = w->slot_lens[i];
+		}
+	}
+	return last_len;
+}
+
+/*
+ * Position in output buffer, for one of the formats;
+ * the pointers for the others are NULL.
+ */
+typedef struct OutBuf {
+	int16_t *i16; /* 16-bit stereo (interleaved) */
+	float *f32;   /* float stereo (interleaved), or left if planar */
+	float *f32_r; /* float right, if planar */
+} OutBuf;
+
+/*
+ * Write \p len samples from the mix buffers of \p mixer
+ * to the output buffer, advancing the position.
+ */
+static void out_write(OutBuf *restrict out,
+		SAU_Mixer *restrict mixer, uint32_t len) {
+	if (out->i16 != NULL)
+		SAU_Mixer_write(mixer, &out->i16, len);
+	else if (out->f32_r != NULL)
+		SAU_Mixer_write_f32_planar(mixer,
+				&out->f32, &out->f32_r, len);
+	else if (out->f32 != NULL)
+		SAU_Mixer_write_f32(mixer, &out->f32, len);
+}
+
+/*
+ * Advance the output buffer position by \p len samples.
+ */
+static void out_advance(OutBuf *restrict out, uint32_t len) {
+	if (out->i16 != NULL)
+		out->i16 += len+len; /* stereo double */
+	else if (out->f32_r != NULL) {
+		out->f32 += len;
+		out->f32_r += len;
+	} else if (out->f32 != NULL)
+		out->f32 += len+len; /* stereo double */
+}
+
 /*
  * Run voices for \p time, repeatedly generating up to BUF_LEN samples
- * and writing them into the 16-bit stereo (interleaved) buffer \p buf.
+ * and writing them to the output buffer from \p out, unless skipping.
+ *
+ * Only the voices playing are run, those which end being removed.
  *
  * \return number of samples generated
  */
 static uint32_t run_for_time(SAU_Interp *restrict o,
-		uint32_t time, int16_t *restrict buf) {
-	int16_t *sp = buf;
+		uint32_t time, const OutBuf *restrict out) {
+	OutBuf pos = *out;
 	uint32_t gen_len = 0;
 	while (time > 0) {
 		uint32_t len = time;
 		if (len > BUF_LEN) len = BUF_LEN;
-		SAU_Mixer_clear(o->mixer);
+		if (!o->skip)
+			SAU_Mixer_clear(o->mixer);
 		uint32_t last_len = 0;
-		for (uint32_t i = o->voice; i < o->vo_count; ++i) {
-			VoiceNode *vn = &o->voices[i];
-			if (vn->pos < 0) {
-				/*
-				 * Wait times accumulate across nodes.
-				 *
-				 * Reduce length by wait time and
-				 * end if wait time(s) have swallowed it up.
-				 */
-				uint32_t wait_time = (uint32_t) -vn->pos;
-				if (wait_time >= len) {
-					vn->pos += len;
-					break;
-				}
-				sp += wait_time+wait_time; /* stereo double */
-				len -= wait_time;
-				gen_len += wait_time;
-				vn->pos = 0;
-			}
-			if (vn->duration != 0) {
-				uint32_t voice_len = run_voice(o, vn, len);
+		uint32_t i, active_count = 0;
+		if (o->workers != NULL && o->active_count > 1) {
+			last_len = run_batches(o, len);
+		} else {
+			RunScratch *rs = &o->scratch[0];
+			rs->mixer = o->mixer;
+			for (i = 0; i < o->active_count; ++i) {
+				VoiceNode *vn = &o->voices[o->active[i]];
+				if (vn->duration == 0) continue;
+				uint32_t voice_len = run_voice(o, rs, vn, len);
 				if (voice_len > last_len) last_len = voice_len;
 			}
 		}
+		for (i = 0; i < o->active_count; ++i) {
+			uint16_t vo_id = o->active[i];
+			VoiceNode *vn = &o->voices[vo_id];
+			if (vn->duration != 0)
+				o->active[active_count++] = vo_id;
+			else
+				vn->flags &= ~VN_ACTIVE;
+		}
+		o->active_count = active_count;
 		time -= len;
 		if (last_len > 0) {
 			gen_len += last_len;
-			SAU_Mixer_write(o->mixer, &sp, last_len);
+			if (!o->skip)
+				out_write(&pos, o->mixer, last_len);
 		}
 	}
 	return gen_len;
@@ -417,22 +1453,17 @@ static void check_final_state(SAU_Interp *restrict o) {
 	}
 }
 
-/**
- * Main audio generation/processing function. Call repeatedly to write
- * buf_len new samples into the interleaved stereo buffer buf. Any values
- * after the end of the signal will be zero'd.
+/*
+ * Handle events and run voices for \p buf_len samples, writing
+ * them to the output buffer \p out, or only advancing the state
+ * if skipping.
  *
  * \return number of samples generated, buf_len unless signal ended
  */
-size_t SAU_Interp_run(SAU_Interp *restrict o,
-		int16_t *restrict buf, size_t buf_len) {
-	int16_t *sp = buf;
-	uint32_t i, len = buf_len;
-	for (i = len; i--; sp += 2) {
-		sp[0] = 0;
-		sp[1] = 0;
-	}
-	sp = buf;
+static size_t run_signal(SAU_Interp *restrict o,
+		const OutBuf *restrict out, size_t buf_len) {
+	OutBuf pos = *out;
+	uint32_t len = buf_len;
 	uint32_t skip_len, last_len, gen_len = 0;
 PROCESS:
 	skip_len = 0;
@@ -457,31 +1488,24 @@ PROCESS:
 		++o->event;
 		o->event_pos = 0;
 	}
-	last_len = run_for_time(o, len, sp);
+	last_len = run_for_time(o, len, &pos);
 	if (skip_len > 0) {
 		gen_len += len;
-		sp += len+len; /* stereo double */
+		out_advance(&pos, len);
 		len = skip_len;
 		goto PROCESS;
 	} else {
 		gen_len += last_len;
 	}
 	/*
-	 * Advance starting voice and check for end of signal.
+	 * Check for end of signal.
 	 */
-	for(;;) {
-		VoiceNode *vn;
-		if (o->voice == o->vo_count) {
-			if (o->event != o->ev_count) break;
-			/*
-			 * The end.
-			 */
-			check_final_state(o);
-			return gen_len;
-		}
-		vn = &o->voices[o->voice];
-		if (vn->duration != 0) break;
-		++o->voice;
+	if (o->active_count == 0 && o->event == o->ev_count) {
+		/*
+		 * The end.
+		 */
+		check_final_state(o);
+		return gen_len;
 	}
 	/*
 	 * Further calls needed to complete signal.
@@ -489,6 +1513,465 @@ PROCESS:
 	return buf_len;
 }
 
+/*
+ * Copy the current state into snapshot \p i of the index.
+ */
+static void index_save(SAU_Interp *restrict o, uint32_t i) {
+	Index *x = o->index;
+	x->snaps[i] = (IndexSnap){o->pos, o->event, o->event_pos,
+		o->active_count};
+	memcpy(&x->operators[i * o->op_count], o->operators,
+			o->op_count * sizeof(*o->operators));
+	memcpy(&x->voices[i * o->vo_count], o->voices,
+			o->vo_count * sizeof(*o->voices));
+	memcpy(&x->active[i * o->vo_count], o->active,
+			o->vo_count * sizeof(*o->active));
+}
+
+/*
+ * Set the current state to that of snapshot \p i of the index.
+ */
+static void index_restore(SAU_Interp *restrict o, uint32_t i) {
+	Index *x = o->index;
+	const IndexSnap *snap = &x->snaps[i];
+	o->pos = snap->pos;
+	o->event = snap->event;
+	o->event_pos = snap->event_pos;
+	o->active_count = snap->active_count;
+	memcpy(o->operators, &x->operators[i * o->op_count],
+			o->op_count * sizeof(*o->operators));
+	memcpy(o->voices, &x->voices[i * o->vo_count],
+			o->vo_count * sizeof(*o->voices));
+	memcpy(o->active, &x->active[i * o->vo_count],
+			o->vo_count * sizeof(*o->active));
+}
+
+/*
+ * Move snapshot \p src of the index to \p dst, an earlier one.
+ */
+static void index_move(SAU_Interp *restrict o,
+		uint32_t dst, uint32_t src) {
+	Index *x = o->index;
+	x->snaps[dst] = x->snaps[src];
+	memcpy(&x->operators[dst * o->op_count],
+			&x->operators[src * o->op_count],
+			o->op_count * sizeof(*o->operators));
+	memcpy(&x->voices[dst * o->vo_count],
+			&x->voices[src * o->vo_count],
+			o->vo_count * sizeof(*o->voices));
+	memcpy(&x->active[dst * o->vo_count],
+			&x->active[src * o->vo_count],
+			o->vo_count * sizeof(*o->active));
+}
+
+/*
+ * Record a snapshot of the current state in the index. If full,
+ * first drops every other snapshot, doubling the interval.
+ */
+static void index_record(SAU_Interp *restrict o) {
+	Index *x = o->index;
+	if (x->count == x->max) {
+		uint32_t i;
+		for (i = 1; i * 2 < x->count; ++i)
+			index_move(o, i, i * 2);
+		x->count = i;
+		x->interval *= 2;
+	}
+	index_save(o, x->count++);
+	x->next_pos = (o->pos / x->interval + 1) * x->interval;
+}
+
+/*
+ * Find the last snapshot in the index at or before \p pos.
+ *
+ * \return snapshot number, or UINT32_MAX if none
+ */
+static uint32_t index_find(const Index *restrict x, size_t pos) {
+	uint32_t lo = 0, hi = x->count;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (x->snaps[mid].pos <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo > 0) ? lo - 1 : UINT32_MAX;
+}
+
+/*
+ * Run for \p buf_len samples, writing them to the zero'd
+ * output buffer \p out, or skipping if NULL.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+static size_t run_out(SAU_Interp *restrict o,
+		const OutBuf *restrict out, size_t buf_len) {
+	static const OutBuf no_out = {0};
+	if (o->index != NULL && o->pos >= o->index->next_pos)
+		index_record(o);
+	o->skip = !out;
+	size_t len = run_signal(o, o->skip ? &no_out : out, buf_len);
+	o->skip = false;
+	o->pos += len;
+	return len;
+}
+
+/**
+ * Main audio generation/processing function. Call repeatedly to write
+ * buf_len new samples into the interleaved stereo buffer buf. Any values
+ * after the end of the signal will be zero'd.
+ *
+ * The 16-bit output is converted from the float signal, clipped.
+ * See SAU_Interp_run_f32() for the unclipped signal.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run(SAU_Interp *restrict o,
+		int16_t *restrict buf, size_t buf_len) {
+	memset(buf, 0, buf_len * 2 * sizeof(*buf));
+	OutBuf out = {.i16 = buf};
+	return run_out(o, &out, buf_len);
+}
+
+/**
+ * Like SAU_Interp_run(), but writes buf_len new samples into the
+ * interleaved stereo float buffer buf, without clipping or other
+ * conversion of the signal. Any values after the end of the signal
+ * will be zero'd.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run_f32(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len) {
+	memset(buf, 0, buf_len * 2 * sizeof(*buf));
+	OutBuf out = {.f32 = buf};
+	return run_out(o, &out, buf_len);
+}
+
+/**
+ * Like SAU_Interp_run_f32(), but writes buf_len new samples into
+ * the separate float buffers buf_l and buf_r, for the left and
+ * right channels.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run_f32_planar(SAU_Interp *restrict o,
+		float *restrict buf_l, float *restrict buf_r,
+		size_t buf_len) {
+	memset(buf_l, 0, buf_len * sizeof(*buf_l));
+	memset(buf_r, 0, buf_len * sizeof(*buf_r));
+	OutBuf out = {.f32 = buf_l, .f32_r = buf_r};
+	return run_out(o, &out, buf_len);
+}
+
+/**
+ * Advance past buf_len samples without generating them, like a call
+ * to SAU_Interp_run() would. The state after is the same, so that
+ * later output is too, if the calls up until then use the same
+ * lengths. Only what affects later output is computed; oscillators
+ * are advanced in closed form, except where used for FM.
+ *
+ * \return number of samples skipped, buf_len unless signal ended
+ */
+size_t SAU_Interp_skip(SAU_Interp *restrict o, size_t buf_len) {
+	return run_out(o, NULL, buf_len);
+}
+
+/**
+ * Skip ahead to sample position \p pos, counted from the start of the
+ * signal, without generating audio. Calls SAU_Interp_skip() for up to
+ * \p run_len samples at a time, the last call shortened to reach \p pos.
+ *
+ * Later output is the same as if running with \p run_len all along,
+ * provided that all calls up until now were for \p run_len samples,
+ * and that \p pos is a multiple of it. Otherwise, it may differ, by
+ * rounding, as the processing is split differently.
+ *
+ * If a snapshot index is used, first goes to the last snapshot at or
+ * before \p pos if that is ahead, or if \p pos is behind. Going back
+ * is otherwise not possible.
+ *
+ * \return position reached, less than \p pos if signal ended,
+ *         or greater if behind and not possible to go back to
+ */
+size_t SAU_Interp_seek(SAU_Interp *restrict o, size_t pos, size_t run_len) {
+	if (!run_len) run_len = BUF_LEN;
+	if (o->index != NULL) {
+		uint32_t i = index_find(o->index, pos);
+		if (i != UINT32_MAX && (o->index->snaps[i].pos > o->pos ||
+					o->pos > pos))
+			index_restore(o, i);
+	}
+	while (o->pos < pos) {
+		size_t len = pos - o->pos;
+		if (len > run_len) len = run_len;
+		if (SAU_Interp_skip(o, len) < len)
+			break;
+	}
+	return o->pos;
+}
+
+/**
+ * Enable recording of a snapshot of the state every \p interval_ms,
+ * starting with the current state, when running or skipping ahead,
+ * for SAU_Interp_seek() to go to the nearest snapshot before running
+ * on. At most \p max_size bytes are used for snapshots; when full,
+ * every other snapshot is dropped and the interval doubled. Disables
+ * and frees any previous index, and only does that if \p interval_ms
+ * is 0.
+ *
+ * \return true, or false on allocation failure or if \p max_size
+ *         is too small for two snapshots
+ */
+bool SAU_Interp_set_index(SAU_Interp *restrict o,
+		uint32_t interval_ms, size_t max_size) {
+	fini_index(o);
+	if (!interval_ms)
+		return true;
+	size_t snap_size = sizeof(IndexSnap) +
+		o->op_count * sizeof(*o->operators) +
+		o->vo_count * (sizeof(*o->voices) + sizeof(*o->active));
+	size_t interval = SAU_MS_IN_SAMPLES(interval_ms, o->srate);
+	if (!interval) interval = 1;
+	if (max_size < sizeof(Index))
+		return false;
+	size_t max = (max_size - sizeof(Index)) / snap_size;
+	if (max < 2)
+		return false;
+	/* no more than needed for the duration of the program */
+	size_t needed = SAU_MS_IN_SAMPLES(o->prg->duration_ms, o->srate) /
+		interval + 2;
+	if (max > needed) max = needed;
+	if (max > UINT32_MAX) max = UINT32_MAX;
+	Index *x = calloc(1, sizeof(Index));
+	if (!x)
+		return false;
+	o->index = x; /* cleaned up by fini_index() from here */
+	x->interval = interval;
+	x->max = max;
+	x->snaps = malloc(max * sizeof(*x->snaps));
+	if (o->op_count > 0)
+		x->operators = malloc(max * o->op_count *
+				sizeof(*o->operators));
+	if (o->vo_count > 0) {
+		x->voices = malloc(max * o->vo_count * sizeof(*o->voices));
+		x->active = malloc(max * o->vo_count * sizeof(*o->active));
+	}
+	if (!x->snaps || (o->op_count > 0 && !x->operators) ||
+			(o->vo_count > 0 && (!x->voices || !x->active))) {
+		fini_index(o);
+		return false;
+	}
+	index_record(o);
+	return true;
+}
+
+/**
+ * Get the number of bytes allocated for the snapshot index,
+ * which is at most the \p max_size passed when enabling it.
+ *
+ * \return size in bytes, 0 if not enabled
+ */
+size_t SAU_Interp_index_size(const SAU_Interp *restrict o) {
+	const Index *x = o->index;
+	if (!x)
+		return 0;
+	return sizeof(Index) + x->max * (sizeof(IndexSnap) +
+		o->op_count * sizeof(*o->operators) +
+		o->vo_count * (sizeof(*o->voices) + sizeof(*o->active)));
+}
+
+/**
+ * Print information about the snapshot index, if enabled.
+ */
+void SAU_Interp_print_index(const SAU_Interp *restrict o) {
+	const Index *x = o->index;
+	if (!x)
+		return;
+	fprintf(stdout,
+		"\tIndex:    \t%u snapshots (max %u), every %zu samples, "
+		"%zu bytes\n",
+		x->count, x->max, x->interval, SAU_Interp_index_size(o));
+}
+
+/*
+ * Header of state saved by SAU_Interp_save(), followed by
+ * an OpState per operator, a VoState per voice, and the IDs
+ * of voices playing.
+ */
+typedef struct InterpState {
+	uint64_t pos;
+	uint64_t event;
+	uint32_t event_pos;
+	uint32_t op_count;
+	uint16_t vo_count;
+	uint16_t active_count;
+	float scale;
+} InterpState;
+
+/*
+ * Saved operator state. Pointers into the program are not included,
+ * but set again by SAU_Interp_load(), like when handling events.
+ */
+typedef struct OpState {
+	uint32_t phase;
+	uint32_t time;
+	uint32_t silence;
+	uint8_t wave;
+	uint8_t flags;
+	SAU_Ramp amp, freq;
+	SAU_Ramp amp2, freq2;
+	uint32_t amp_pos, freq_pos;
+	uint32_t amp2_pos, freq2_pos;
+} OpState;
+
+/*
+ * Saved voice state. Pointers excluded, as for OpState.
+ */
+typedef struct VoState {
+	uint32_t duration;
+	uint8_t flags;
+	SAU_Ramp pan;
+	uint32_t pan_pos;
+} VoState;
+
+/**
+ * Save the current state to \p f, in binary form for the machine used,
+ * for loading with SAU_Interp_load() into a new instance for the same
+ * program and options.
+ *
+ * \return true unless write failed
+ */
+bool SAU_Interp_save(const SAU_Interp *restrict o, FILE *restrict f) {
+	InterpState st;
+	memset(&st, 0, sizeof(st)); /* no unset padding written */
+	st.pos = o->pos;
+	st.event = o->event;
+	st.event_pos = o->event_pos;
+	st.op_count = o->op_count;
+	st.vo_count = o->vo_count;
+	st.active_count = o->active_count;
+	st.scale = o->mixer->scale;
+	if (fwrite(&st, sizeof(st), 1, f) != 1)
+		return false;
+	for (uint32_t i = 0; i < o->op_count; ++i) {
+		const OperatorNode *on = &o->operators[i];
+		OpState os;
+		memset(&os, 0, sizeof(os));
+		os.phase = on->osc.phase;
+		os.time = on->time;
+		os.silence = on->silence;
+		os.wave = on->osc.wave;
+		os.flags = on->flags;
+		os.amp = on->amp;
+		os.freq = on->freq;
+		os.amp2 = on->amp2;
+		os.freq2 = on->freq2;
+		os.amp_pos = on->amp_pos;
+		os.freq_pos = on->freq_pos;
+		os.amp2_pos = on->amp2_pos;
+		os.freq2_pos = on->freq2_pos;
+		if (fwrite(&os, sizeof(os), 1, f) != 1)
+			return false;
+	}
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		const VoiceNode *vn = &o->voices[i];
+		VoState vs;
+		memset(&vs, 0, sizeof(vs));
+		vs.duration = vn->duration;
+		vs.flags = vn->flags;
+		vs.pan = vn->pan;
+		vs.pan_pos = vn->pan_pos;
+		if (fwrite(&vs, sizeof(vs), 1, f) != 1)
+			return false;
+	}
+	if (o->active_count > 0 && fwrite(o->active, sizeof(*o->active),
+				o->active_count, f) != o->active_count)
+		return false;
+	return true;
+}
+
+/**
+ * Load state saved by SAU_Interp_save() from \p f, into a new
+ * instance for the same program and options. Later output is then
+ * the same as for the instance saved from. On failure, the instance
+ * is left partly changed and should not be run.
+ *
+ * \return true, or false if read failed or state does not match
+ */
+bool SAU_Interp_load(SAU_Interp *restrict o, FILE *restrict f) {
+	InterpState st;
+	if (fread(&st, sizeof(st), 1, f) != 1)
+		goto ERROR;
+	if (st.op_count != o->op_count || st.vo_count != o->vo_count ||
+			st.active_count > o->vo_count ||
+			st.event > o->ev_count ||
+			st.scale != o->mixer->scale)
+		goto ERROR;
+	/*
+	 * Set pointers into the program as handling the events did.
+	 */
+	for (size_t i = 0; i < st.event; ++i) {
+		const EventNode *e = o->events[i];
+		const SAU_ProgramEvent *prg_e = e->prg_e;
+		for (size_t j = 0; j < prg_e->op_data_count; ++j) {
+			const SAU_ProgramOpData *od = &prg_e->op_data[j];
+			OperatorNode *on = &o->operators[od->id];
+			on->fmods = od->fmods;
+			on->pmods = od->pmods;
+			on->amods = od->amods;
+		}
+		if (prg_e->vo_id != SAU_PVO_NO_ID && e->graph != NULL) {
+			VoiceNode *vn = &o->voices[prg_e->vo_id];
+			vn->graph = e->graph;
+			vn->graph_count = e->graph_count;
+			vn->sched = e->sched;
+		}
+	}
+	for (uint32_t i = 0; i < o->op_count; ++i) {
+		OperatorNode *on = &o->operators[i];
+		OpState os;
+		if (fread(&os, sizeof(os), 1, f) != 1)
+			goto ERROR;
+		SAU_Osc_set_wave(&on->osc, os.wave);
+		on->osc.phase = os.phase;
+		on->time = os.time;
+		on->silence = os.silence;
+		on->flags = os.flags;
+		on->amp = os.amp;
+		on->freq = os.freq;
+		on->amp2 = os.amp2;
+		on->freq2 = os.freq2;
+		on->amp_pos = os.amp_pos;
+		on->freq_pos = os.freq_pos;
+		on->amp2_pos = os.amp2_pos;
+		on->freq2_pos = os.freq2_pos;
+	}
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		VoiceNode *vn = &o->voices[i];
+		VoState vs;
+		if (fread(&vs, sizeof(vs), 1, f) != 1)
+			goto ERROR;
+		vn->duration = vs.duration;
+		vn->flags = vs.flags;
+		vn->pan = vs.pan;
+		vn->pan_pos = vs.pan_pos;
+	}
+	if (st.active_count > 0 && fread(o->active, sizeof(*o->active),
+				st.active_count, f) != st.active_count)
+		goto ERROR;
+	for (uint32_t i = 0; i < st.active_count; ++i)
+		if (o->active[i] >= o->vo_count)
+			goto ERROR;
+	o->pos = st.pos;
+	o->event = st.event;
+	o->event_pos = st.event_pos;
+	o->active_count = st.active_count;
+	return true;
+ERROR:
+	return false;
+}
+
 static void print_graph(const SAU_ProgramOpRef *restrict graph,
 		uint32_t count) {
 	static const char *const uses[SAU_POP_USES] = {
@@ -523,6 +2006,8 @@ static void print_graph(const SAU_ProgramOpRef *restrict graph,
  */
 void SAU_Interp_print(const SAU_Interp *restrict o) {
 	SAU_Program_print_info(o->prg, "Program: \"", "\"");
+	fprintf(stdout,
+		"\tBuffers:  \t%d\n", o->buf_count);
 	for (size_t ev_id = 0; ev_id < o->ev_count; ++ev_id) {
 		const EventNode *ev = o->events[ev_id];
 		const SAU_ProgramEvent *prg_ev = ev->prg_e;
@@ -538,4 +2023,5 @@ void SAU_Interp_print(const SAU_Interp *restrict o) {
 		SAU_ProgramEvent_print_operators(prg_ev);
 		putc('\n', stdout);
 	}
+	SAU_Interp_print_index(o);
 }
@@ -13,15 +13,44 @@
 
 #pragma once
 #include "../program.h"
+#include <stdio.h>
 
 struct SAU_Interp;
 typedef struct SAU_Interp SAU_Interp;
 
+/**
+ * Interpreter option flags.
+ */
+enum {
+	SAU_INTERP_POLYBLEP = 1<<0, /* analytic sqr, saw, tri waves */
+	SAU_INTERP_CTL_RAMPS = 1<<1, /* control-rate ramps, unless set */
+};
+
+/**
+ * Largest number of threads used by an interpreter.
+ */
+#define SAU_INTERP_THREADS_MAX 64
+
 SAU_Interp* SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) sauMalloclike;
+		uint32_t srate, uint32_t flags, uint32_t threads) sauMalloclike;
 void SAU_destroy_Interp(SAU_Interp *restrict o);
 
 size_t SAU_Interp_run(SAU_Interp *restrict o,
 		int16_t *restrict buf, size_t buf_len);
+size_t SAU_Interp_run_f32(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len);
+size_t SAU_Interp_run_f32_planar(SAU_Interp *restrict o,
+		float *restrict buf_l, float *restrict buf_r,
+		size_t buf_len);
+size_t SAU_Interp_skip(SAU_Interp *restrict o, size_t buf_len);
+size_t SAU_Interp_seek(SAU_Interp *restrict o, size_t pos, size_t run_len);
+
+bool SAU_Interp_set_index(SAU_Interp *restrict o,
+		uint32_t interval_ms, size_t max_size);
+size_t SAU_Interp_index_size(const SAU_Interp *restrict o);
+
+bool SAU_Interp_save(const SAU_Interp *restrict o, FILE *restrict f);
+bool SAU_Interp_load(SAU_Interp *restrict o, FILE *restrict f);
 
 void SAU_Interp_print(const SAU_Interp *restrict o);
+void SAU_Interp_print_index(const SAU_Interp *restrict o);
@@ -60,14 +60,12 @@ void SAU_Mixer_clear(SAU_Mixer *restrict o) {
 /**
  * Add \p len samples from \p buf into the mix buffers,
  * using \p pan for panning and scaling each sample.
- *
- * Sample rate needs to be set if \p pan has curve enabled.
  */
 void SAU_Mixer_add(SAU_Mixer *restrict o,
 		float *restrict buf, size_t len,
 		SAU_Ramp *restrict pan, uint32_t *restrict pan_pos) {
 	if (pan->flags & SAU_RAMPP_GOAL) {
-		SAU_Ramp_run(pan, pan_pos, o->pan_buf, len, o->srate, NULL);
+		SAU_Ramp_run(pan, pan_pos, o->pan_buf, len, NULL);
 		for (size_t i = 0; i < len; ++i) {
 			float s = buf[i] * o->scale;
 			float s_r = s * o->pan_buf[i];
@@ -84,10 +82,48 @@ void SAU_Mixer_add(SAU_Mixer *restrict o,
 	}
 }
 
+/**
+ * Run \p osc for \p len samples, with \p freq, \p amp and
+ * \p osc_flags as for SAU_Osc_run(), adding the output into
+ * the mix buffers using \p pan for panning and scaling.
+ *
+ * Like running the oscillator into a buffer and adding it using
+ * SAU_Mixer_add(), but without the buffer, and \p pan must be
+ * held (have no goal set).
+ */
+void SAU_Mixer_add_osc(SAU_Mixer *restrict o,
+		SAU_Osc *restrict osc, size_t len,
+		const float *restrict freq,
+		const float *restrict amp, uint32_t osc_flags,
+		const SAU_Ramp *restrict pan) {
+	SAU_Osc_run_pan(osc, o->mix_l, o->mix_r, len,
+			freq, amp, o->scale, pan->v0, osc_flags);
+}
+
+/**
+ * Add \p len samples from position \p pos in the mix
+ * buffers of \p src into those of \p o, e.g. to combine
+ * output from voices run into separate mixers.
+ */
+void SAU_Mixer_add_mix(SAU_Mixer *restrict o,
+		const SAU_Mixer *restrict src, size_t pos, size_t len) {
+	const float *restrict src_l = src->mix_l + pos;
+	const float *restrict src_r = src->mix_r + pos;
+	float *restrict mix_l = o->mix_l + pos;
+	float *restrict mix_r = o->mix_r + pos;
+	for (size_t i = 0; i < len; ++i) {
+		mix_l[i] += src_l[i];
+		mix_r[i] += src_r[i];
+	}
+}
+
 /**
  * Write \p len samples from the mix buffers
  * into a 16-bit stereo (interleaved) buffer
  * pointed to by \p spp. Advances \p spp.
+ *
+ * This is the conversion for 16-bit output,
+ * clipping values outside of [-1.0, 1.0].
  */
 void SAU_Mixer_write(SAU_Mixer *restrict o,
 		int16_t **restrict spp, size_t len) {
@@ -102,3 +138,36 @@ void SAU_Mixer_write(SAU_Mixer *restrict o,
 		*(*spp)++ += lrintf(s_r * (float) INT16_MAX);
 	}
 }
+
+/**
+ * Write \p len samples from the mix buffers
+ * into a float stereo (interleaved) buffer
+ * pointed to by \p spp. Advances \p spp.
+ *
+ * Values are copied as they are, unclipped.
+ */
+void SAU_Mixer_write_f32(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len) {
+	float *restrict sp = *spp;
+	for (size_t i = 0; i < len; ++i) {
+		*sp++ = o->mix_l[i];
+		*sp++ = o->mix_r[i];
+	}
+	*spp = sp;
+}
+
+/**
+ * Write \p len samples from the mix buffers
+ * into float left and right channel buffers
+ * pointed to by \p lpp and \p rpp. Advances
+ * \p lpp and \p rpp.
+ *
+ * Values are copied as they are, unclipped.
+ */
+void SAU_Mixer_write_f32_planar(SAU_Mixer *restrict o,
+		float **restrict lpp, float **restrict rpp, size_t len) {
+	memcpy(*lpp, o->mix_l, len * sizeof(float));
+	memcpy(*rpp, o->mix_r, len * sizeof(float));
+	*lpp += len;
+	*rpp += len;
+}
@@ -13,26 +13,19 @@
 
 #pragma once
 #include "../ramp.h"
+#include "osc.h"
 
 #define SAU_MIX_BUFLEN 1024
 
 typedef struct SAU_Mixer {
 	float *mix_l, *mix_r;
 	float *pan_buf;
-	uint32_t srate;
 	float scale;
 } SAU_Mixer;
 
 SAU_Mixer *SAU_create_Mixer(void) sauMalloclike;
 void SAU_destroy_Mixer(SAU_Mixer *restrict o);
 
-/**
- * Set sample rate used for panning.
- */
-static inline void SAU_Mixer_set_srate(SAU_Mixer *restrict o, uint32_t srate) {
-	o->srate = srate;
-}
-
 /**
  * Set amplitude scaling.
  */
@@ -44,5 +37,16 @@ void SAU_Mixer_clear(SAU_Mixer *restrict o);
 void SAU_Mixer_add(SAU_Mixer *restrict o,
 		float *restrict buf, size_t len,
 		SAU_Ramp *restrict pan, uint32_t *restrict pan_pos);
+void SAU_Mixer_add_osc(SAU_Mixer *restrict o,
+		SAU_Osc *restrict osc, size_t len,
+		const float *restrict freq,
+		const float *restrict amp, uint32_t osc_flags,
+		const SAU_Ramp *restrict pan);
+void SAU_Mixer_add_mix(SAU_Mixer *restrict o,
+		const SAU_Mixer *restrict src, size_t pos, size_t len);
 void SAU_Mixer_write(SAU_Mixer *restrict o,
 		int16_t **restrict spp, size_t len);
+void SAU_Mixer_write_f32(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len);
+void SAU_Mixer_write_f32_planar(SAU_Mixer *restrict o,
+		float **restrict lpp, float **restrict rpp, size_t len);
@@ -16,6 +16,722 @@
  */
 
 #include "osc.h"
+#include <pthread.h>
+
+/*
+ * Loop version flags. Combined, they give the index
+ * of a loop version among those defined for each
+ * implementation of the main run functions.
+ */
+enum {
+	V_FREQ_CONST = SAU_OSC_FREQ_CONST,
+	V_AMP_CONST = SAU_OSC_AMP_CONST,
+	V_PM = 1<<2,
+	V_LAYER = 1<<3,
+	V_COUNT = 1<<4
+};
+
+typedef void (*RunFunc)(SAU_Osc *restrict o,
+		float *restrict buf, size_t buf_len,
+		const float *restrict freq,
+		const float *restrict amp,
+		const float *restrict pm_f);
+
+/*
+ * Waves generated analytically for the PolyBLEP mode. LUT_WAVE,
+ * last, is used for plain lookup in the wave LUT picked.
+ */
+enum {
+	BLEP_SQR = 0,
+	BLEP_SAW,
+	BLEP_TRI,
+	LUT_WAVE
+};
+
+/*
+ * PolyBLEP residual for a step of +2 at phase 0, for phase \p t
+ * (0.0 - 1.0) and phase increment \p dt per sample (\p dt_r its
+ * reciprocal).
+ */
+static sauAlwaysInline float poly_blep(float t, float dt, float dt_r) {
+	if (t < dt) {
+		t *= dt_r;
+		return t+t - t*t - 1.f;
+	} else if (t > 1.f - dt) {
+		t = (t - 1.f) * dt_r;
+		return t*t + t+t + 1.f;
+	}
+	return 0.f;
+}
+
+/*
+ * PolyBLAMP residual for a slope change of +1 per sample at phase 0,
+ * for phase \p t (0.0 - 1.0) and phase increment \p dt per sample
+ * (\p dt_r its reciprocal).
+ */
+static sauAlwaysInline float poly_blamp(float t, float dt, float dt_r) {
+	if (t < dt) {
+		t = 1.f - t * dt_r;
+	} else if (t > 1.f - dt) {
+		t = 1.f - (1.f - t) * dt_r;
+	} else
+		return 0.f;
+	return t*t*t * (1.f/6);
+}
+
+/*
+ * Convert 32-bit unsigned phase to 0.0 - 1.0 range.
+ */
+#define PHASE_F(phase) ((phase) * (1.f / 4294967296.f))
+
+/*
+ * Get sample of \p w (BLEP_*) wave for 32-bit unsigned \p phase,
+ * corrected for steps and corners given phase increment \p dt
+ * (\p dt_r its reciprocal).
+ *
+ * The shapes and phases match those of the wave LUTs.
+ */
+static sauAlwaysInline float get_blep(uint32_t w, uint32_t phase,
+		float dt, float dt_r) {
+	const float t = PHASE_F(phase);
+	float s, t2, t3;
+	switch (w) {
+	case BLEP_SQR:
+		s = (phase < 0x80000000) ? 1.f : -1.f;
+		t2 = t + s * 0.5f;
+		s += poly_blep(t, dt, dt_r);
+		s -= poly_blep(t2, dt, dt_r);
+		break;
+	case BLEP_SAW:
+		s = 1.f - (t + t);
+		s += poly_blep(t, dt, dt_r);
+		break;
+	default: /* BLEP_TRI */
+		s = t * 4.f;
+		if (phase >= 0xC0000000)
+			s -= 4.f;
+		else if (phase >= 0x40000000)
+			s = 2.f - s;
+		t2 = t - 0.25f;
+		if (t2 < 0.f) t2 += 1.f;
+		t3 = t + 0.25f;
+		if (t3 >= 1.f) t3 -= 1.f;
+		s -= 8.f * dt * (poly_blamp(t2, dt, dt_r) -
+				poly_blamp(t3, dt, dt_r));
+		break;
+	}
+	return s;
+}
+
+/*
+ * Plain C loop, the body of all SAU_Osc_run() and SAU_Osc_run_env()
+ * versions, specialized for each version \p v as a constant, and for
+ * \p w, either LUT_WAVE or a wave generated analytically (BLEP_*).
+ *
+ * \return number of samples generated, always \p buf_len
+ */
+static sauAlwaysInline size_t run_c_body(SAU_Osc *restrict o,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env, uint32_t w,
+		const float *restrict freq,
+		const float *restrict amp,
+		const float *restrict pm_f) {
+	const SAU_WaveVal *restrict lut = o->lut;
+	uint32_t inc = 0;
+	float dt = 0.f, dt_r = 0.f;
+	float s_amp = 0.f;
+	if (v & V_FREQ_CONST) {
+		inc = lrintf(o->coeff * freq[0]);
+		if (w != LUT_WAVE) {
+			dt = PHASE_F(fabsf(o->coeff * freq[0]));
+			dt_r = 1.f / dt;
+		}
+	}
+	if (v & V_AMP_CONST) s_amp = amp[0];
+	for (size_t i = 0; i < buf_len; ++i) {
+		int32_t s_pm = 0;
+		if (v & V_PM) {
+			s_pm = lrintf(pm_f[i] * (float) INT32_MAX);
+		}
+		if (!(v & V_FREQ_CONST) && w != LUT_WAVE) {
+			dt = PHASE_F(fabsf(o->coeff * freq[i]));
+			dt_r = 1.f / dt;
+		}
+		float s = (w == LUT_WAVE) ?
+			SAU_Wave_get_lerp(lut, o->phase + s_pm) :
+			get_blep(w, o->phase + s_pm, dt, dt_r);
+		if (v & V_FREQ_CONST)
+			o->phase += inc;
+		else
+			o->phase += lrintf(o->coeff * freq[i]);
+		if (!(v & V_AMP_CONST)) s_amp = amp[i];
+		if (!env) {
+			s *= s_amp;
+			if (v & V_LAYER) s += buf[i];
+		} else {
+			float s_amp_h = s_amp * 0.5f;
+			s = (s * s_amp_h) + fabs(s_amp_h);
+			if (v & V_LAYER) s *= buf[i];
+		}
+		buf[i] = s;
+	}
+	return buf_len;
+}
+
+/*
+ * Define loop version \p v named \p name suffixed with it, for wave
+ * \p w, using the \p body loop with function attributes \p attr.
+ * The plain C loop finishes what's left by \p body, if anything.
+ */
+#define DEF_RUN(name, attr, body, env, w, v) \
+static attr void name##_##v(SAU_Osc *restrict o, \
+		float *restrict buf, size_t buf_len, \
+		const float *restrict freq, \
+		const float *restrict amp, \
+		const float *restrict pm_f) { \
+	size_t i = body(o, buf, buf_len, (v), (env), (w), \
+			freq, amp, pm_f); \
+	if (i < buf_len) run_c_body(o, buf + i, buf_len - i, \
+			(v), (env), (w), \
+			((v) & V_FREQ_CONST) ? freq : freq + i, \
+			((v) & V_AMP_CONST) ? amp : amp + i, \
+			((v) & V_PM) ? pm_f + i : NULL); \
+}
+
+/*
+ * Define all loop versions for wave \p w using \p body loop,
+ * and an array named \p name suffixed with "_fs" of them.
+ */
+#define DEF_RUN_VERSIONS(name, attr, body, env, w) \
+DEF_RUN(name, attr, body, env, w, 0)  DEF_RUN(name, attr, body, env, w, 1) \
+DEF_RUN(name, attr, body, env, w, 2)  DEF_RUN(name, attr, body, env, w, 3) \
+DEF_RUN(name, attr, body, env, w, 4)  DEF_RUN(name, attr, body, env, w, 5) \
+DEF_RUN(name, attr, body, env, w, 6)  DEF_RUN(name, attr, body, env, w, 7) \
+DEF_RUN(name, attr, body, env, w, 8)  DEF_RUN(name, attr, body, env, w, 9) \
+DEF_RUN(name, attr, body, env, w, 10) DEF_RUN(name, attr, body, env, w, 11) \
+DEF_RUN(name, attr, body, env, w, 12) DEF_RUN(name, attr, body, env, w, 13) \
+DEF_RUN(name, attr, body, env, w, 14) DEF_RUN(name, attr, body, env, w, 15) \
+static const RunFunc name##_fs[V_COUNT] = { \
+	name##_0,  name##_1,  name##_2,  name##_3, \
+	name##_4,  name##_5,  name##_6,  name##_7, \
+	name##_8,  name##_9,  name##_10, name##_11, \
+	name##_12, name##_13, name##_14, name##_15, \
+};
+
+/*
+ * Number of sine values computed per step of the rotation loops,
+ * and the maximum number of samples before the rotation restarts.
+ */
+#define ROT_LANES 16
+#define ROT_SYNC  1024
+
+/*
+ * Rotation sine state, for the loops used when a sine has constant
+ * frequency and no PM input. Instead of LUT lookup, the values are
+ * produced by repeated complex rotation, which vectorizes fully.
+ *
+ * Holds the cosine (\a re) and sine (\a im) values for the next
+ * ROT_LANES samples, and the rotation to apply to get the values
+ * for the ROT_LANES samples after them.
+ */
+typedef struct RotSin {
+	float re[ROT_LANES], im[ROT_LANES];
+	float rot_re, rot_im;
+	double w_re, w_im;
+	uint32_t inc;
+} RotSin;
+
+/*
+ * Initialize rotation sine state for frequency \p freq.
+ */
+static void rot_init(RotSin *restrict r, const SAU_Osc *restrict o,
+		float freq) {
+	r->inc = lrintf(o->coeff * freq);
+	double w = (int32_t) r->inc * (2.0 * SAU_PI / 4294967296.0);
+	r->w_re = cos(w);
+	r->w_im = sin(w);
+	double rot_re = r->w_re, rot_im = r->w_im;
+	for (int n = 1; n < ROT_LANES; n <<= 1) {
+		double tmp = rot_re * rot_re - rot_im * rot_im;
+		rot_im = 2.0 * rot_re * rot_im;
+		rot_re = tmp;
+	}
+	r->rot_re = rot_re;
+	r->rot_im = rot_im;
+}
+
+/*
+ * (Re)start rotation from the current phase, and advance the
+ * phase past the number of samples, at most ROT_SYNC of \p len,
+ * to generate before the next restart. (To limit the accumulation
+ * of rounding errors, rotation doesn't continue for longer.)
+ *
+ * \return number of samples to generate
+ */
+static size_t rot_start(RotSin *restrict r, SAU_Osc *restrict o,
+		size_t len) {
+	double x = o->phase * (2.0 * SAU_PI / 4294967296.0);
+	double x_re = cos(x), x_im = sin(x);
+	for (int k = 0; k < ROT_LANES; ++k) {
+		r->re[k] = x_re;
+		r->im[k] = x_im;
+		double tmp = x_re * r->w_re - x_im * r->w_im;
+		x_im = x_re * r->w_im + x_im * r->w_re;
+		x_re = tmp;
+	}
+	if (len > ROT_SYNC) len = ROT_SYNC;
+	o->phase += r->inc * len;
+	return len;
+}
+
+/*
+ * Plain C rotation sine loop, for loop version \p v (V_FREQ_CONST
+ * set, V_PM not). Continues from the lanes of a partly finished step,
+ * if any, as left by a SIMD loop.
+ *
+ * \return number of samples generated, always \p buf_len
+ */
+static sauAlwaysInline size_t run_rot_c_body(RotSin *restrict r,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env,
+		const float *restrict amp) {
+	float s_amp = 0.f;
+	if (v & V_AMP_CONST) s_amp = amp[0];
+	for (size_t i = 0; i < buf_len; ++i) {
+		const int k = i & (ROT_LANES - 1);
+		float s = r->im[k];
+		if (k == ROT_LANES - 1) {
+			for (int n = 0; n < ROT_LANES; ++n) {
+				float tmp = r->re[n] * r->rot_re -
+					r->im[n] * r->rot_im;
+				r->im[n] = r->re[n] * r->rot_im +
+					r->im[n] * r->rot_re;
+				r->re[n] = tmp;
+			}
+		}
+		if (!(v & V_AMP_CONST)) s_amp = amp[i];
+		if (!env) {
+			s *= s_amp;
+			if (v & V_LAYER) s += buf[i];
+		} else {
+			float s_amp_h = s_amp * 0.5f;
+			s = (s * s_amp_h) + fabs(s_amp_h);
+			if (v & V_LAYER) s *= buf[i];
+		}
+		buf[i] = s;
+	}
+	return buf_len;
+}
+
+/*
+ * Define rotation sine loop version \p v named \p name suffixed
+ * with it, using the \p body loop with function attributes \p attr.
+ * The plain C loop finishes what's left by \p body, if anything.
+ */
+#define DEF_ROT(name, attr, body, env, v) \
+static attr void name##_##v(SAU_Osc *restrict o, \
+		float *restrict buf, size_t buf_len, \
+		const float *restrict freq, \
+		const float *restrict amp, \
+		const float *restrict pm_f sauMaybeUnused) { \
+	RotSin r; \
+	rot_init(&r, o, freq[0]); \
+	for (size_t i = 0; i < buf_len; ) { \
+		const float *restrict s_amp = \
+			((v) & V_AMP_CONST) ? amp : amp + i; \
+		size_t len = rot_start(&r, o, buf_len - i); \
+		size_t j = body(&r, buf + i, len, (v), (env), s_amp); \
+		if (j < len) run_rot_c_body(&r, buf + i + j, len - j, \
+				(v), (env), \
+				((v) & V_AMP_CONST) ? s_amp : s_amp + j); \
+		i += len; \
+	} \
+}
+
+/*
+ * Define the rotation sine loop versions using \p body loop, and
+ * an array named \p name suffixed with "_fs" of them, NULL for the
+ * versions not supported.
+ */
+#define DEF_ROT_VERSIONS(name, attr, body, env) \
+DEF_ROT(name, attr, body, env, 1)  DEF_ROT(name, attr, body, env, 3) \
+DEF_ROT(name, attr, body, env, 9)  DEF_ROT(name, attr, body, env, 11) \
+static const RunFunc name##_fs[V_COUNT] = { \
+	[1] = name##_1, [3] = name##_3, \
+	[9] = name##_9, [11] = name##_11, \
+};
+
+/*
+ * Number of oscillators run together in a sine bank,
+ * and the number of samples generated per step.
+ */
+#define BANK_LANES 8
+#define BANK_STEP  8
+
+/*
+ * Sine bank state, for running up to BANK_LANES sines with constant
+ * frequency and amplitude together, vectorized across the sines
+ * rather than across samples. Like for the rotation sine loops,
+ * values are produced by complex rotation.
+ *
+ * Holds the cosine (\a re) and sine (\a im) values, multiplied by
+ * the amplitude, for the next BANK_STEP samples, and the rotation
+ * to apply to get the values for the BANK_STEP samples after them.
+ * Unused lanes are kept at zero.
+ */
+typedef struct SinBank {
+	float re[BANK_STEP][BANK_LANES], im[BANK_STEP][BANK_LANES];
+	float rot_re[BANK_LANES], rot_im[BANK_LANES];
+} SinBank;
+
+typedef size_t (*BankFunc)(SinBank *restrict b,
+		float *restrict buf, size_t buf_len);
+
+/*
+ * Set up sine bank state for the \p count (at most BANK_LANES)
+ * oscillators \p oscs, with frequencies \p freqs and amplitudes
+ * \p amps, and advance their phases past \p len samples.
+ */
+static void bank_start(SinBank *restrict b,
+		SAU_Osc *const *restrict oscs, size_t count, size_t len,
+		const float *restrict freqs,
+		const float *restrict amps) {
+	for (size_t k = 0; k < BANK_LANES; ++k) {
+		if (k >= count) {
+			for (int t = 0; t < BANK_STEP; ++t)
+				b->re[t][k] = b->im[t][k] = 0.f;
+			b->rot_re[k] = 1.f;
+			b->rot_im[k] = 0.f;
+			continue;
+		}
+		SAU_Osc *o = oscs[k];
+		uint32_t inc = lrintf(o->coeff * freqs[k]);
+		double w = (int32_t) inc * (2.0 * SAU_PI / 4294967296.0);
+		double w_re = cos(w), w_im = sin(w);
+		double x = o->phase * (2.0 * SAU_PI / 4294967296.0);
+		double x_re = amps[k] * cos(x), x_im = amps[k] * sin(x);
+		for (int t = 0; t < BANK_STEP; ++t) {
+			b->re[t][k] = x_re;
+			b->im[t][k] = x_im;
+			double tmp = x_re * w_re - x_im * w_im;
+			x_im = x_re * w_im + x_im * w_re;
+			x_re = tmp;
+		}
+		for (int n = 1; n < BANK_STEP; n <<= 1) {
+			double tmp = w_re * w_re - w_im * w_im;
+			w_im = 2.0 * w_re * w_im;
+			w_re = tmp;
+		}
+		b->rot_re[k] = w_re;
+		b->rot_im[k] = w_im;
+		o->phase += inc * len;
+	}
+}
+
+/*
+ * Plain C sine bank loop, adding the sum of the sines to \p buf
+ * (assigning it instead for \p add false). The lanes are summed
+ * pairwise, as in the SIMD loops. Must begin at the start of a
+ * step; the SIMD loops leave off at one.
+ *
+ * \return number of samples generated, always \p buf_len
+ */
+static sauAlwaysInline size_t run_bank_c_body(SinBank *restrict b,
+		float *restrict buf, size_t buf_len, bool add) {
+	for (size_t i = 0; i < buf_len; ++i) {
+		const int j = i & (BANK_STEP - 1);
+		const float *im = b->im[j];
+		float s = ((im[0] + im[1]) + (im[2] + im[3])) +
+			((im[4] + im[5]) + (im[6] + im[7]));
+		if (j == BANK_STEP - 1) {
+			for (int t = 0; t < BANK_STEP; ++t)
+			for (int k = 0; k < BANK_LANES; ++k) {
+				float tmp = b->re[t][k] * b->rot_re[k] -
+					b->im[t][k] * b->rot_im[k];
+				b->im[t][k] = b->re[t][k] * b->rot_im[k] +
+					b->im[t][k] * b->rot_re[k];
+				b->re[t][k] = tmp;
+			}
+		}
+		buf[i] = add ? buf[i] + s : s;
+	}
+	return buf_len;
+}
+
+/*
+ * Plain C sine bank loop for finishing a run, shared by all versions.
+ */
+static sauNoinline void run_bank_tail(SinBank *restrict b,
+		float *restrict buf, size_t buf_len, bool add) {
+	run_bank_c_body(b, buf, buf_len, add);
+}
+
+/*
+ * Define sine bank loop versions named \p name suffixed with 0
+ * (assigning) and 1 (adding), using the \p body loop with function
+ * attributes \p attr, and an array named \p name suffixed with "_fs"
+ * of them. The plain C loop finishes what's left by \p body, if anything.
+ */
+#define DEF_BANK(name, attr, body) \
+static attr size_t name##_0(SinBank *restrict b, \
+		float *restrict buf, size_t buf_len) { \
+	size_t i = body(b, buf, buf_len, false); \
+	if (i < buf_len) run_bank_tail(b, buf + i, buf_len - i, false); \
+	return buf_len; \
+} \
+static attr size_t name##_1(SinBank *restrict b, \
+		float *restrict buf, size_t buf_len) { \
+	size_t i = body(b, buf, buf_len, true); \
+	if (i < buf_len) run_bank_tail(b, buf + i, buf_len - i, true); \
+	return buf_len; \
+} \
+static const BankFunc name##_fs[2] = { name##_0, name##_1 };
+
+typedef void (*PanFunc)(SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan);
+
+/*
+ * Plain C loop for SAU_Osc_run_pan(), specialized like run_c_body()
+ * for version \p v (only V_FREQ_CONST and V_AMP_CONST used) and wave
+ * \p w. Scales and pans each sample the way SAU_Mixer_add() does,
+ * adding it to \p buf_l and \p buf_r.
+ *
+ * \return number of samples generated, always \p buf_len
+ */
+static sauAlwaysInline size_t run_pan_c_body(SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		uint32_t v, uint32_t w,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan) {
+	const SAU_WaveVal *restrict lut = o->lut;
+	uint32_t inc = 0;
+	float dt = 0.f, dt_r = 0.f;
+	float s_amp = 0.f;
+	if (v & V_FREQ_CONST) {
+		inc = lrintf(o->coeff * freq[0]);
+		if (w != LUT_WAVE) {
+			dt = PHASE_F(fabsf(o->coeff * freq[0]));
+			dt_r = 1.f / dt;
+		}
+	}
+	if (v & V_AMP_CONST) s_amp = amp[0];
+	for (size_t i = 0; i < buf_len; ++i) {
+		if (!(v & V_FREQ_CONST) && w != LUT_WAVE) {
+			dt = PHASE_F(fabsf(o->coeff * freq[i]));
+			dt_r = 1.f / dt;
+		}
+		float s = (w == LUT_WAVE) ?
+			SAU_Wave_get_lerp(lut, o->phase) :
+			get_blep(w, o->phase, dt, dt_r);
+		if (v & V_FREQ_CONST)
+			o->phase += inc;
+		else
+			o->phase += lrintf(o->coeff * freq[i]);
+		if (!(v & V_AMP_CONST)) s_amp = amp[i];
+		s = (s * s_amp) * scale;
+		float s_r = s * pan;
+		buf_l[i] += s - s_r;
+		buf_r[i] += s + s_r;
+	}
+	return buf_len;
+}
+
+/*
+ * Plain C rotation sine loop for SAU_Osc_run_pan(), for version \p v
+ * (V_FREQ_CONST set). Written a step of ROT_LANES samples at a time,
+ * for the compiler to vectorize. Must begin at the start of a step.
+ */
+static sauAlwaysInline void run_rot_pan_c_body(RotSin *restrict r,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		uint32_t v,
+		const float *restrict amp,
+		float scale, float pan) {
+	for (size_t i = 0; i < buf_len; i += ROT_LANES) {
+		size_t len = buf_len - i;
+		if (len > ROT_LANES) len = ROT_LANES;
+		for (size_t k = 0; k < len; ++k) {
+			float s_amp = (v & V_AMP_CONST) ? amp[0] : amp[i + k];
+			float s = (r->im[k] * s_amp) * scale;
+			float s_r = s * pan;
+			buf_l[i + k] += s - s_r;
+			buf_r[i + k] += s + s_r;
+		}
+		for (int n = 0; n < ROT_LANES; ++n) {
+			float tmp = r->re[n] * r->rot_re -
+				r->im[n] * r->rot_im;
+			r->im[n] = r->re[n] * r->rot_im +
+				r->im[n] * r->rot_re;
+			r->re[n] = tmp;
+		}
+	}
+}
+
+/*
+ * Define panned loop version \p v (0-3) for wave \p w named \p name
+ * suffixed with it, using the \p body loop with function attributes
+ * \p attr. The plain C loop finishes what's left by \p body, if anything.
+ */
+#define DEF_PAN(name, attr, body, w, v) \
+static attr void name##_##v(SAU_Osc *restrict o, \
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len, \
+		const float *restrict freq, \
+		const float *restrict amp, \
+		float scale, float pan) { \
+	size_t i = body(o, buf_l, buf_r, buf_len, (v), (w), \
+			freq, amp, scale, pan); \
+	if (i < buf_len) run_pan_c_body(o, buf_l + i, buf_r + i, \
+			buf_len - i, (v), (w), \
+			((v) & V_FREQ_CONST) ? freq : freq + i, \
+			((v) & V_AMP_CONST) ? amp : amp + i, \
+			scale, pan); \
+}
+
+/*
+ * Define all panned loop versions for wave \p w using \p body loop,
+ * and an array named \p name suffixed with "_fs" of them.
+ */
+#define DEF_PAN_VERSIONS(name, attr, body, w) \
+DEF_PAN(name, attr, body, w, 0) DEF_PAN(name, attr, body, w, 1) \
+DEF_PAN(name, attr, body, w, 2) DEF_PAN(name, attr, body, w, 3) \
+static const PanFunc name##_fs[4] = { \
+	name##_0, name##_1, name##_2, name##_3, \
+};
+
+/*
+ * Define panned rotation sine loop version \p v named \p name suffixed
+ * with it, with function attributes \p attr (for the compiler to use
+ * when vectorizing the plain C loop).
+ */
+#define DEF_ROT_PAN(name, attr, v) \
+static attr void name##_##v(SAU_Osc *restrict o, \
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len, \
+		const float *restrict freq, \
+		const float *restrict amp, \
+		float scale, float pan) { \
+	RotSin r; \
+	rot_init(&r, o, freq[0]); \
+	for (size_t i = 0; i < buf_len; ) { \
+		size_t len = rot_start(&r, o, buf_len - i); \
+		run_rot_pan_c_body(&r, buf_l + i, buf_r + i, len, (v), \
+				((v) & V_AMP_CONST) ? amp : amp + i, \
+				scale, pan); \
+		i += len; \
+	} \
+}
+
+/*
+ * Define the panned rotation sine loop versions, and an array named
+ * \p name suffixed with "_fs" of them, NULL for the versions not
+ * supported.
+ */
+#define DEF_ROT_PAN_VERSIONS(name, attr) \
+DEF_ROT_PAN(name, attr, 1) DEF_ROT_PAN(name, attr, 3) \
+static const PanFunc name##_fs[4] = { \
+	[1] = name##_1, [3] = name##_3, \
+};
+
+DEF_RUN_VERSIONS(run_c, , run_c_body, false, LUT_WAVE)
+DEF_RUN_VERSIONS(run_env_c, , run_c_body, true, LUT_WAVE)
+DEF_RUN_VERSIONS(run_sqr_c, , run_c_body, false, BLEP_SQR)
+DEF_RUN_VERSIONS(run_env_sqr_c, , run_c_body, true, BLEP_SQR)
+DEF_RUN_VERSIONS(run_saw_c, , run_c_body, false, BLEP_SAW)
+DEF_RUN_VERSIONS(run_env_saw_c, , run_c_body, true, BLEP_SAW)
+DEF_RUN_VERSIONS(run_tri_c, , run_c_body, false, BLEP_TRI)
+DEF_RUN_VERSIONS(run_env_tri_c, , run_c_body, true, BLEP_TRI)
+DEF_ROT_VERSIONS(run_rot_c, , run_rot_c_body, false)
+DEF_ROT_VERSIONS(run_env_rot_c, , run_rot_c_body, true)
+DEF_BANK(run_bank_c, , run_bank_c_body)
+DEF_PAN_VERSIONS(run_pan_sqr_c, , run_pan_c_body, BLEP_SQR)
+DEF_PAN_VERSIONS(run_pan_saw_c, , run_pan_c_body, BLEP_SAW)
+DEF_PAN_VERSIONS(run_pan_tri_c, , run_pan_c_body, BLEP_TRI)
+DEF_ROT_PAN_VERSIONS(run_rot_pan_c, )
+
+static const RunFunc *run_fs = run_c_fs;
+static const RunFunc *run_env_fs = run_env_c_fs;
+static const RunFunc *rot_fs = run_rot_c_fs;
+static const RunFunc *rot_env_fs = run_env_rot_c_fs;
+static const BankFunc *bank_fs = run_bank_c_fs;
+static const PanFunc *rot_pan_fs = run_rot_pan_c_fs;
+
+/*
+ * Loop versions for the PolyBLEP mode, or NULL for
+ * wave types without an analytic version.
+ */
+static const RunFunc *blep_fs[SAU_WAVE_TYPES] = {
+	[SAU_WAVE_SQR] = run_sqr_c_fs,
+	[SAU_WAVE_TRI] = run_tri_c_fs,
+	[SAU_WAVE_SAW] = run_saw_c_fs,
+};
+static const RunFunc *blep_env_fs[SAU_WAVE_TYPES] = {
+	[SAU_WAVE_SQR] = run_env_sqr_c_fs,
+	[SAU_WAVE_TRI] = run_env_tri_c_fs,
+	[SAU_WAVE_SAW] = run_env_saw_c_fs,
+};
+static const PanFunc *blep_pan_fs[SAU_WAVE_TYPES] = {
+	[SAU_WAVE_SQR] = run_pan_sqr_c_fs,
+	[SAU_WAVE_TRI] = run_pan_tri_c_fs,
+	[SAU_WAVE_SAW] = run_pan_saw_c_fs,
+};
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__i386__) || defined(__x86_64__))
+# include "osc/x86.c"
+# define INIT_ARCH() init_x86()
+#else
+# define INIT_ARCH() ((void)0)
+#endif
+
+static void init_arch(void) {
+	INIT_ARCH();
+}
+
+/**
+ * Select the oscillator loop versions to use,
+ * according to the features of the CPU.
+ *
+ * If already initialized, return without doing anything.
+ * Safe to call from several threads at once.
+ */
+void SAU_global_init_Osc(void) {
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, init_arch);
+}
+
+/*
+ * Pick the band-limited LUT level for the highest frequency of the run,
+ * so that no harmonics above the Nyquist frequency remain. (PM is not
+ * taken into account.)
+ */
+static void pick_lut(SAU_Osc *restrict o,
+		const float *restrict freq, size_t buf_len, uint32_t flags) {
+	float max_freq = fabsf(freq[0]);
+	if (!(flags & SAU_OSC_FREQ_CONST)) {
+		for (size_t i = 1; i < buf_len; ++i) {
+			float f = fabsf(freq[i]);
+			if (f > max_freq) max_freq = f;
+		}
+	}
+	float inc = o->coeff * max_freq;
+	uint32_t level = (inc < 2147483648.f) ?
+		SAU_Wave_mip_level(lrintf(inc)) :
+		(SAU_Wave_MIPLEVELS - 1);
+	o->lut = SAU_Wave_luts[o->wave][level];
+}
+
+/*
+ * Get loop version index for arguments.
+ */
+static inline uint32_t get_version(uint32_t layer,
+		const float *restrict pm_f, uint32_t flags) {
+	uint32_t v = flags & (V_FREQ_CONST | V_AMP_CONST);
+	if (pm_f != NULL) v |= V_PM;
+	if (layer > 0) v |= V_LAYER;
+	return v;
+}
 
 /**
  * Run for \p buf_len samples, generating output
@@ -25,22 +741,31 @@
  * the output to \p buf instead of assigning it.
  *
  * \p pm_f may be NULL for no PM input.
+ *
+ * \p flags (SAU_OSC_*) may mark \p freq and/or \p amp as
+ * holding one value for the whole run, only read once.
+ *
+ * The wave LUT level is picked according to the frequency, unless
+ * the SAU_OSC_POLYBLEP flag is used and the wave can be generated
+ * analytically. A sine with constant frequency and no PM input is
+ * generated without the LUT, by complex rotation.
  */
 void SAU_Osc_run(SAU_Osc *restrict o,
 		float *restrict buf, size_t buf_len,
 		uint32_t layer,
 		const float *restrict freq,
 		const float *restrict amp,
-		const float *restrict pm_f) {
-	for (size_t i = 0; i < buf_len; ++i) {
-		int32_t s_pm = 0;
-		if (pm_f != NULL) {
-			s_pm = lrintf(pm_f[i] * (float) INT32_MAX);
-		}
-		float s = SAU_Osc_get(o, freq[i], s_pm) * amp[i];
-		if (layer > 0) s += buf[i];
-		buf[i] = s;
-	}
+		const float *restrict pm_f,
+		uint32_t flags) {
+	const uint32_t v = get_version(layer, pm_f, flags);
+	const RunFunc *fs = run_fs;
+	if (o->wave == SAU_WAVE_SIN && rot_fs[v] != NULL)
+		fs = rot_fs;
+	else if ((flags & SAU_OSC_POLYBLEP) && blep_fs[o->wave] != NULL)
+		fs = blep_fs[o->wave];
+	else
+		pick_lut(o, freq, buf_len, flags);
+	fs[v](o, buf, buf_len, freq, amp, pm_f);
 }
 
 /**
@@ -52,22 +777,155 @@ void SAU_Osc_run(SAU_Osc *restrict o,
  * the output into \p buf instead of assigning it.
  *
  * \p pm_f may be NULL for no PM input.
+ *
+ * \p flags (SAU_OSC_*) may mark \p freq and/or \p amp as
+ * holding one value for the whole run, only read once.
+ *
+ * The wave LUT level is picked according to the frequency, unless
+ * the SAU_OSC_POLYBLEP flag is used and the wave can be generated
+ * analytically. A sine with constant frequency and no PM input is
+ * generated without the LUT, by complex rotation.
  */
 void SAU_Osc_run_env(SAU_Osc *restrict o,
 		float *restrict buf, size_t buf_len,
 		uint32_t layer,
 		const float *restrict freq,
 		const float *restrict amp,
-		const float *restrict pm_f) {
-	for (size_t i = 0; i < buf_len; ++i) {
-		int32_t s_pm = 0;
-		if (pm_f != NULL) {
-			s_pm = lrintf(pm_f[i] * (float) INT32_MAX);
+		const float *restrict pm_f,
+		uint32_t flags) {
+	const uint32_t v = get_version(layer, pm_f, flags);
+	const RunFunc *fs = run_env_fs;
+	if (o->wave == SAU_WAVE_SIN && rot_env_fs[v] != NULL)
+		fs = rot_env_fs;
+	else if ((flags & SAU_OSC_POLYBLEP) && blep_env_fs[o->wave] != NULL)
+		fs = blep_env_fs[o->wave];
+	else
+		pick_lut(o, freq, buf_len, flags);
+	fs[v](o, buf, buf_len, freq, amp, pm_f);
+}
+
+/**
+ * Advance the phase past \p buf_len samples, without generating
+ * output, leaving the oscillator as running it for them with
+ * SAU_Osc_run() or another run function would.
+ *
+ * \p flags (SAU_OSC_*) may mark \p freq as holding one value
+ * for the whole run, only read once.
+ */
+void SAU_Osc_skip(SAU_Osc *restrict o, size_t buf_len,
+		const float *restrict freq, uint32_t flags) {
+	if (flags & SAU_OSC_FREQ_CONST) {
+		uint32_t inc = lrintf(o->coeff * freq[0]);
+		o->phase += inc * (uint32_t) buf_len;
+		return;
+	}
+	for (size_t i = 0; i < buf_len; ++i)
+		o->phase += lrintf(o->coeff * freq[i]);
+}
+
+/*
+ * Number of samples per tile for run_pan_tiled().
+ */
+#define PAN_TILE 256
+
+/*
+ * Run LUT wave for SAU_Osc_run_pan(), using the SAU_Osc_run() loop
+ * version \p v to fill a small buffer at a time, then scaling and
+ * panning it. (Gathering LUT values runs slower when the loop also
+ * loads and stores the output buffers, so that is not fused.)
+ */
+static void run_pan_tiled(SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		uint32_t v,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan) {
+	float tile[PAN_TILE];
+	for (size_t i = 0; i < buf_len; i += PAN_TILE) {
+		size_t len = buf_len - i;
+		if (len > PAN_TILE) len = PAN_TILE;
+		run_fs[v](o, tile, len,
+				(v & V_FREQ_CONST) ? freq : freq + i,
+				(v & V_AMP_CONST) ? amp : amp + i, NULL);
+		for (size_t j = 0; j < len; ++j) {
+			float s = tile[j] * scale;
+			float s_r = s * pan;
+			buf_l[i + j] += s - s_r;
+			buf_r[i + j] += s + s_r;
+		}
+	}
+}
+
+/**
+ * Run for \p buf_len samples, generating carrier output
+ * which is scaled by \p scale, panned by \p pan (-1.0 to
+ * 1.0, left to right), and added to \p buf_l and \p buf_r.
+ * The result is like that of SAU_Osc_run() followed by
+ * SAU_Mixer_add() with a held pan value, in one pass where
+ * the wave is generated without LUT lookup.
+ *
+ * \p flags (SAU_OSC_*) may mark \p freq and/or \p amp as
+ * holding one value for the whole run, only read once.
+ */
+void SAU_Osc_run_pan(SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan,
+		uint32_t flags) {
+	const uint32_t v = flags & (V_FREQ_CONST | V_AMP_CONST);
+	const PanFunc *fs;
+	if (o->wave == SAU_WAVE_SIN && rot_pan_fs[v] != NULL)
+		fs = rot_pan_fs;
+	else if ((flags & SAU_OSC_POLYBLEP) && blep_pan_fs[o->wave] != NULL)
+		fs = blep_pan_fs[o->wave];
+	else {
+		pick_lut(o, freq, buf_len, flags);
+		run_pan_tiled(o, buf_l, buf_r, buf_len, v, freq, amp,
+				scale, pan);
+		return;
+	}
+	fs[v](o, buf_l, buf_r, buf_len, freq, amp, scale, pan);
+}
+
+/**
+ * Run \p count sine oscillators \p oscs together as a bank for
+ * \p buf_len samples, generating the sum of their output. Each has
+ * a constant frequency and amplitude, the values given in \p freqs
+ * and \p amps, and gets no PM input. The result is like that of
+ * running each with SAU_Osc_run() in turn, with the wave type ignored,
+ * but computed without LUT lookup, vectorized across the oscillators.
+ *
+ * For \p layer greater than zero, adds
+ * the output to \p buf instead of assigning it.
+ *
+ * Any group of fewer than SAU_Osc_BANK_MIN oscillators left over
+ * after filling the banks is run with SAU_Osc_run() instead.
+ */
+void SAU_Osc_run_sin_bank(SAU_Osc *const *restrict oscs, size_t count,
+		float *restrict buf, size_t buf_len,
+		uint32_t layer,
+		const float *restrict freqs,
+		const float *restrict amps) {
+	for (size_t i = 0; i < buf_len; i += ROT_SYNC) {
+		size_t len = buf_len - i;
+		if (len > ROT_SYNC) len = ROT_SYNC;
+		for (size_t j = 0; j < count; j += BANK_LANES) {
+			SinBank b;
+			size_t n = count - j;
+			if (n > BANK_LANES) n = BANK_LANES;
+			if (n < SAU_Osc_BANK_MIN) {
+				for (size_t k = 0; k < n; ++k)
+					SAU_Osc_run(oscs[j + k], buf + i, len,
+						layer + j + k, &freqs[j + k],
+						&amps[j + k], NULL,
+						SAU_OSC_FREQ_CONST |
+						SAU_OSC_AMP_CONST);
+				continue;
+			}
+			bank_start(&b, oscs + j, n, len,
+					freqs + j, amps + j);
+			bank_fs[layer > 0 || j > 0](&b, buf + i, len);
 		}
-		float s = SAU_Osc_get(o, freq[i], s_pm);
-		float s_amp = amp[i] * 0.5f;
-		s = (s * s_amp) + fabs(s_amp);
-		if (layer > 0) s *= buf[i];
-		buf[i] = s;
 	}
 }
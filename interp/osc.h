@@ -22,7 +22,8 @@
 typedef struct SAU_Osc {
 	uint32_t phase;
 	float coeff;
-	const float *lut;
+	const SAU_WaveVal *lut; /* LUT level picked for last run */
+	uint8_t wave;
 } SAU_Osc;
 
 /**
@@ -39,10 +40,14 @@ typedef struct SAU_Osc {
 #define SAU_Osc_COEFF(srate) ((float) 4294967296.0/(srate))
 
 /**
- * Get LUT for wave type enum.
+ * Set wave type enum, using sine for invalid values.
  */
-#define SAU_Osc_LUT(wave) \
-	(SAU_Wave_luts[(wave) < SAU_WAVE_TYPES ? (wave) : SAU_WAVE_SIN])
+static inline void SAU_Osc_set_wave(SAU_Osc *restrict o, uint8_t wave) {
+	if (wave >= SAU_WAVE_TYPES)
+		wave = SAU_WAVE_SIN;
+	o->wave = wave;
+	o->lut = SAU_Wave_luts[wave][0];
+}
 
 /**
  * Initialize instance for use.
@@ -50,7 +55,7 @@ typedef struct SAU_Osc {
 static inline void SAU_init_Osc(SAU_Osc *restrict o, uint32_t srate) {
 	o->phase = 0;
 	o->coeff = SAU_Osc_COEFF(srate);
-	o->lut = SAU_Osc_LUT(SAU_WAVE_SIN);
+	SAU_Osc_set_wave(o, SAU_WAVE_SIN);
 }
 
 /**
@@ -99,15 +104,52 @@ static inline float SAU_Osc_get(SAU_Osc *restrict o,
 	return s;
 }
 
+void SAU_global_init_Osc(void);
+
+/**
+ * Run flags. The first mark inputs as constant for the run.
+ *
+ * SAU_OSC_POLYBLEP selects generating the "sqr", "saw" and "tri" waves
+ * analytically, with PolyBLEP and PolyBLAMP corrections, instead of
+ * using the wave LUTs.
+ */
+enum {
+	SAU_OSC_FREQ_CONST = 1<<0,
+	SAU_OSC_AMP_CONST = 1<<1,
+	SAU_OSC_POLYBLEP = 1<<2,
+};
+
 void SAU_Osc_run(SAU_Osc *restrict o,
 		float *restrict buf, size_t buf_len,
 		uint32_t layer,
 		const float *restrict freq,
 		const float *restrict amp,
-		const float *restrict pm_f);
+		const float *restrict pm_f,
+		uint32_t flags);
 void SAU_Osc_run_env(SAU_Osc *restrict o,
 		float *restrict buf, size_t buf_len,
 		uint32_t layer,
 		const float *restrict freq,
 		const float *restrict amp,
-		const float *restrict pm_f);
+		const float *restrict pm_f,
+		uint32_t flags);
+void SAU_Osc_run_pan(SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan,
+		uint32_t flags);
+void SAU_Osc_skip(SAU_Osc *restrict o, size_t buf_len,
+		const float *restrict freq, uint32_t flags);
+
+/**
+ * Minimum number of oscillators for which running them together
+ * using SAU_Osc_run_sin_bank() is worthwhile.
+ */
+#define SAU_Osc_BANK_MIN 6
+
+void SAU_Osc_run_sin_bank(SAU_Osc *const *restrict oscs, size_t count,
+		float *restrict buf, size_t buf_len,
+		uint32_t layer,
+		const float *restrict freqs,
+		const float *restrict amps);
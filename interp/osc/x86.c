@@ -0,0 +1,861 @@
+/* saugns: Oscillator x86 SIMD support.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * SSE2 (4 samples per step) and AVX2 (8 samples per step) versions of
+ * the oscillator loop versions, compiled for their targets using attributes
+ * and picked at run time. Remaining samples use the plain C loops.
+ *
+ * The output matches the plain C version bit-for-bit, provided that no
+ * FMA contraction happens in the latter. (Values which give phase
+ * increments or PM offsets beyond the range of a long are exceptions,
+ * but give undefined results in the plain C version.) For the PolyBLEP
+ * waves, the result may instead differ by rounding, as the compiler is
+ * free to rearrange the arithmetic of the plain C version.
+ */
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+/*
+ * SSE2 version.
+ */
+
+/*
+ * Convert to 32-bit integers, rounding like lrintf() and wrapping around
+ * like a conversion from long would (the values are whole numbers where
+ * that matters, so subtracting multiples of 2^32 is exact).
+ */
+static sauAlwaysInline TARGET_SSE2 __m128i cvt_wrap_sse2(__m128 x) {
+	__m128 wraps = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x,
+				_mm_set1_ps(1.f / 4294967296.f))));
+	x = _mm_sub_ps(x, _mm_mul_ps(wraps, _mm_set1_ps(4294967296.f)));
+	return _mm_cvtps_epi32(x);
+}
+
+/*
+ * Get next 4 phase values, advancing \p phase (all lanes equal).
+ */
+static sauAlwaysInline TARGET_SSE2 __m128i next_phase_sse2(
+		__m128i *restrict phase, __m128 coeff,
+		const float *restrict freq) {
+	__m128i inc = cvt_wrap_sse2(_mm_mul_ps(coeff, _mm_loadu_ps(freq)));
+	__m128i sum = _mm_add_epi32(inc, _mm_slli_si128(inc, 4));
+	sum = _mm_add_epi32(sum, _mm_slli_si128(sum, 8));
+	__m128i ph = _mm_add_epi32(*phase, _mm_sub_epi32(sum, inc));
+	*phase = _mm_add_epi32(*phase, _mm_shuffle_epi32(sum, 0xFF));
+	return ph;
+}
+
+/*
+ * Get 4 LUT values using linear interpolation.
+ *
+ * Each LUT entry is loaded whole, then the values and
+ * differences are separated.
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 get_lerp_sse2(
+		const SAU_WaveVal *restrict lut, __m128i phase) {
+	const __m128 fscale = _mm_set1_ps(1.f / SAU_Wave_SCALE);
+	union { __m128i v; uint32_t a[4]; } ind;
+	ind.v = _mm_srli_epi32(phase, SAU_Wave_SCALEBITS);
+#if SAU_WAVE_INT16
+	__m128i e = _mm_set_epi16(lut[ind.a[3]].d, lut[ind.a[3]].v,
+			lut[ind.a[2]].d, lut[ind.a[2]].v,
+			lut[ind.a[1]].d, lut[ind.a[1]].v,
+			lut[ind.a[0]].d, lut[ind.a[0]].v);
+	__m128 v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(e, 16), 16));
+	__m128 d = _mm_cvtepi32_ps(_mm_srai_epi32(e, 16));
+	__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase,
+				_mm_set1_epi32(SAU_Wave_SCALEMASK))), fscale);
+	return _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(d, x)),
+			_mm_set1_ps(SAU_Wave_VALSCALE));
+#else
+	__m128 e01 = _mm_loadl_pi(_mm_setzero_ps(),
+			(const __m64*) &lut[ind.a[0]]);
+	e01 = _mm_loadh_pi(e01, (const __m64*) &lut[ind.a[1]]);
+	__m128 e23 = _mm_loadl_pi(_mm_setzero_ps(),
+			(const __m64*) &lut[ind.a[2]]);
+	e23 = _mm_loadh_pi(e23, (const __m64*) &lut[ind.a[3]]);
+	__m128 v = _mm_shuffle_ps(e01, e23, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 d = _mm_shuffle_ps(e01, e23, _MM_SHUFFLE(3, 1, 3, 1));
+	__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase,
+				_mm_set1_epi32(SAU_Wave_SCALEMASK))), fscale);
+	return _mm_add_ps(v, _mm_mul_ps(d, x));
+#endif
+}
+
+/*
+ * Pick values from \p a where \p mask is set, otherwise from \p b.
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 select_sse2(__m128 mask,
+		__m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/*
+ * Convert 4 phase values to 0.0 - 1.0 range, like PHASE_F().
+ * (Each 16-bit half is converted exactly, then rounded once.)
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 phase_f_sse2(__m128i phase) {
+	__m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(phase, 16));
+	__m128 lo = _mm_cvtepi32_ps(_mm_and_si128(phase,
+				_mm_set1_epi32(0xFFFF)));
+	return _mm_mul_ps(_mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.f)),
+				lo), _mm_set1_ps(1.f / 4294967296.f));
+}
+
+/*
+ * PolyBLEP residual for 4 values, like poly_blep().
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 poly_blep_sse2(__m128 t,
+		__m128 dt, __m128 dt_r) {
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 x = _mm_mul_ps(t, dt_r);
+	__m128 r = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(x, x),
+				_mm_mul_ps(x, x)), one);
+	x = _mm_mul_ps(_mm_sub_ps(t, one), dt_r);
+	__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x),
+					x), x), one);
+	r2 = _mm_and_ps(_mm_cmpgt_ps(t, _mm_sub_ps(one, dt)), r2);
+	return select_sse2(_mm_cmplt_ps(t, dt), r, r2);
+}
+
+/*
+ * PolyBLAMP residual for 4 values, like poly_blamp().
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 poly_blamp_sse2(__m128 t,
+		__m128 dt, __m128 dt_r) {
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 m = _mm_cmplt_ps(t, dt);
+	__m128 m2 = _mm_cmpgt_ps(t, _mm_sub_ps(one, dt));
+	__m128 x = select_sse2(m, _mm_sub_ps(one, _mm_mul_ps(t, dt_r)),
+			_mm_sub_ps(one, _mm_mul_ps(_mm_sub_ps(one, t), dt_r)));
+	x = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x),
+			_mm_set1_ps(1.f/6));
+	return _mm_and_ps(_mm_or_ps(m, m2), x);
+}
+
+/*
+ * Get 4 samples of \p w (BLEP_*) wave, like get_blep().
+ */
+static sauAlwaysInline TARGET_SSE2 __m128 get_blep_sse2(uint32_t w,
+		__m128i phase, __m128 dt, __m128 dt_r) {
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 t = phase_f_sse2(phase);
+	__m128 s, s2, t2, t3;
+	__m128i q;
+	switch (w) {
+	case BLEP_SQR:
+		s = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(phase,
+					_mm_set1_epi32(0x80000000))), one);
+		t2 = _mm_add_ps(t, _mm_mul_ps(s, _mm_set1_ps(0.5f)));
+		s = _mm_add_ps(s, poly_blep_sse2(t, dt, dt_r));
+		s = _mm_sub_ps(s, poly_blep_sse2(t2, dt, dt_r));
+		break;
+	case BLEP_SAW:
+		s = _mm_sub_ps(one, _mm_add_ps(t, t));
+		s = _mm_add_ps(s, poly_blep_sse2(t, dt, dt_r));
+		break;
+	default: /* BLEP_TRI */
+		s = _mm_mul_ps(t, _mm_set1_ps(4.f));
+		q = _mm_srli_epi32(phase, 30);
+		s2 = _mm_sub_ps(_mm_set1_ps(2.f), s);
+		s = select_sse2(_mm_castsi128_ps(_mm_cmpeq_epi32(q,
+						_mm_set1_epi32(3))),
+				_mm_sub_ps(s, _mm_set1_ps(4.f)),
+				select_sse2(_mm_castsi128_ps(_mm_cmpeq_epi32(
+							q, _mm_setzero_si128())),
+					s, s2));
+		t2 = _mm_sub_ps(t, _mm_set1_ps(0.25f));
+		t2 = _mm_add_ps(t2, _mm_and_ps(_mm_cmplt_ps(t2,
+						_mm_setzero_ps()), one));
+		t3 = _mm_add_ps(t, _mm_set1_ps(0.25f));
+		t3 = _mm_sub_ps(t3, _mm_and_ps(_mm_cmpge_ps(t3, one), one));
+		s2 = _mm_sub_ps(poly_blamp_sse2(t2, dt, dt_r),
+				poly_blamp_sse2(t3, dt, dt_r));
+		s = _mm_sub_ps(s, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(8.f), dt),
+					s2));
+		break;
+	}
+	return s;
+}
+
+/*
+ * Generate 4 samples at a time for loop version \p v and wave \p w.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_SSE2 size_t run_sse2_body(
+		SAU_Osc *restrict o,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env, uint32_t w,
+		const float *restrict freq,
+		const float *restrict amp,
+		const float *restrict pm_f) {
+	const __m128 coeff = _mm_set1_ps(o->coeff);
+	const __m128 pm_scale = _mm_set1_ps((float) INT32_MAX);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(INT32_MAX));
+	const SAU_WaveVal *restrict lut = o->lut;
+	__m128i phase = _mm_set1_epi32(o->phase);
+	__m128i inc_offs = _mm_setzero_si128(), inc_step = inc_offs;
+	__m128 dt = _mm_setzero_ps(), dt_r = dt;
+	__m128 s_amp = _mm_setzero_ps();
+	if (v & V_FREQ_CONST) {
+		uint32_t inc = lrintf(o->coeff * freq[0]);
+		inc_offs = _mm_set_epi32(inc * 3, inc * 2, inc, 0);
+		inc_step = _mm_set1_epi32(inc * 4);
+		if (w != LUT_WAVE) {
+			float dt_s = PHASE_F(fabsf(o->coeff * freq[0]));
+			dt = _mm_set1_ps(dt_s);
+			dt_r = _mm_set1_ps(1.f / dt_s);
+		}
+	}
+	if (v & V_AMP_CONST) s_amp = _mm_set1_ps(amp[0]);
+	size_t i, end = buf_len & ~(size_t) 3;
+	for (i = 0; i < end; i += 4) {
+		__m128i ph;
+		if (v & V_FREQ_CONST) {
+			ph = _mm_add_epi32(phase, inc_offs);
+			phase = _mm_add_epi32(phase, inc_step);
+		} else {
+			ph = next_phase_sse2(&phase, coeff, &freq[i]);
+			if (w != LUT_WAVE) {
+				dt = _mm_mul_ps(_mm_and_ps(_mm_mul_ps(coeff,
+							_mm_loadu_ps(&freq[i])),
+						abs_mask),
+					_mm_set1_ps(1.f / 4294967296.f));
+				dt_r = _mm_div_ps(_mm_set1_ps(1.f), dt);
+			}
+		}
+		if (v & V_PM) {
+			__m128 pm = _mm_mul_ps(_mm_loadu_ps(&pm_f[i]),
+					pm_scale);
+			ph = _mm_add_epi32(ph, cvt_wrap_sse2(pm));
+		}
+		__m128 s = (w == LUT_WAVE) ?
+			get_lerp_sse2(lut, ph) :
+			get_blep_sse2(w, ph, dt, dt_r);
+		if (!(v & V_AMP_CONST)) s_amp = _mm_loadu_ps(&amp[i]);
+		if (!env) {
+			s = _mm_mul_ps(s, s_amp);
+			if (v & V_LAYER)
+				s = _mm_add_ps(s, _mm_loadu_ps(&buf[i]));
+		} else {
+			__m128 s_amp_h = _mm_mul_ps(s_amp, half);
+			s = _mm_add_ps(_mm_mul_ps(s, s_amp_h),
+					_mm_and_ps(s_amp_h, abs_mask));
+			if (v & V_LAYER)
+				s = _mm_mul_ps(s, _mm_loadu_ps(&buf[i]));
+		}
+		_mm_storeu_ps(&buf[i], s);
+	}
+	o->phase = _mm_cvtsi128_si32(phase);
+	return end;
+}
+
+/*
+ * Generate ROT_LANES samples at a time for rotation sine loop
+ * version \p v, as vectors of 4 lanes.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_SSE2 size_t run_rot_sse2_body(
+		RotSin *restrict r,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env,
+		const float *restrict amp) {
+	enum { N = ROT_LANES / 4 };
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(INT32_MAX));
+	const __m128 rot_re = _mm_set1_ps(r->rot_re);
+	const __m128 rot_im = _mm_set1_ps(r->rot_im);
+	__m128 re[N], im[N];
+	__m128 s_amp = _mm_setzero_ps();
+	for (int n = 0; n < N; ++n) {
+		re[n] = _mm_loadu_ps(&r->re[n * 4]);
+		im[n] = _mm_loadu_ps(&r->im[n * 4]);
+	}
+	if (v & V_AMP_CONST) s_amp = _mm_set1_ps(amp[0]);
+	size_t i, end = buf_len & ~(size_t) (ROT_LANES - 1);
+	for (i = 0; i < end; i += ROT_LANES) {
+		for (int n = 0; n < N; ++n) {
+			const size_t j = i + n * 4;
+			__m128 s = im[n];
+			__m128 tmp = _mm_sub_ps(_mm_mul_ps(re[n], rot_re),
+					_mm_mul_ps(im[n], rot_im));
+			im[n] = _mm_add_ps(_mm_mul_ps(re[n], rot_im),
+					_mm_mul_ps(im[n], rot_re));
+			re[n] = tmp;
+			if (!(v & V_AMP_CONST)) s_amp = _mm_loadu_ps(&amp[j]);
+			if (!env) {
+				s = _mm_mul_ps(s, s_amp);
+				if (v & V_LAYER)
+					s = _mm_add_ps(s,
+							_mm_loadu_ps(&buf[j]));
+			} else {
+				__m128 s_amp_h = _mm_mul_ps(s_amp, half);
+				s = _mm_add_ps(_mm_mul_ps(s, s_amp_h),
+						_mm_and_ps(s_amp_h, abs_mask));
+				if (v & V_LAYER)
+					s = _mm_mul_ps(s,
+							_mm_loadu_ps(&buf[j]));
+			}
+			_mm_storeu_ps(&buf[j], s);
+		}
+	}
+	for (int n = 0; n < N; ++n) {
+		_mm_storeu_ps(&r->re[n * 4], re[n]);
+		_mm_storeu_ps(&r->im[n * 4], im[n]);
+	}
+	return end;
+}
+
+/*
+ * Generate BANK_STEP samples at a time for sine bank loop, adding
+ * to \p buf unless \p add is false. The lanes are held in vectors
+ * of 4, summed after transposing.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_SSE2 size_t run_bank_sse2_body(
+		SinBank *restrict b,
+		float *restrict buf, size_t buf_len, bool add) {
+	enum { N = BANK_LANES / 4 };
+	__m128 rot_re[N], rot_im[N];
+	for (int n = 0; n < N; ++n) {
+		rot_re[n] = _mm_loadu_ps(&b->rot_re[n * 4]);
+		rot_im[n] = _mm_loadu_ps(&b->rot_im[n * 4]);
+	}
+	size_t i, end = buf_len & ~(size_t) (BANK_STEP - 1);
+	for (i = 0; i < end; i += BANK_STEP) {
+		for (int t = 0; t < BANK_STEP; t += 4) {
+			__m128 sum[N];
+			for (int n = 0; n < N; ++n) {
+				__m128 s[4];
+				for (int u = 0; u < 4; ++u) {
+					float *re = &b->re[t + u][n * 4];
+					float *im = &b->im[t + u][n * 4];
+					__m128 v_re = _mm_loadu_ps(re);
+					__m128 v_im = _mm_loadu_ps(im);
+					s[u] = v_im;
+					_mm_storeu_ps(re, _mm_sub_ps(
+						_mm_mul_ps(v_re, rot_re[n]),
+						_mm_mul_ps(v_im, rot_im[n])));
+					_mm_storeu_ps(im, _mm_add_ps(
+						_mm_mul_ps(v_re, rot_im[n]),
+						_mm_mul_ps(v_im, rot_re[n])));
+				}
+				_MM_TRANSPOSE4_PS(s[0], s[1], s[2], s[3]);
+				sum[n] = _mm_add_ps(_mm_add_ps(s[0], s[1]),
+						_mm_add_ps(s[2], s[3]));
+			}
+			__m128 s = _mm_add_ps(sum[0], sum[1]);
+			if (add) s = _mm_add_ps(_mm_loadu_ps(&buf[i + t]), s);
+			_mm_storeu_ps(&buf[i + t], s);
+		}
+	}
+	return end;
+}
+
+DEF_RUN_VERSIONS(run_sse2, TARGET_SSE2, run_sse2_body, false, LUT_WAVE)
+DEF_RUN_VERSIONS(run_env_sse2, TARGET_SSE2, run_sse2_body, true, LUT_WAVE)
+DEF_RUN_VERSIONS(run_sqr_sse2, TARGET_SSE2, run_sse2_body, false, BLEP_SQR)
+DEF_RUN_VERSIONS(run_env_sqr_sse2, TARGET_SSE2, run_sse2_body, true, BLEP_SQR)
+DEF_RUN_VERSIONS(run_saw_sse2, TARGET_SSE2, run_sse2_body, false, BLEP_SAW)
+DEF_RUN_VERSIONS(run_env_saw_sse2, TARGET_SSE2, run_sse2_body, true, BLEP_SAW)
+DEF_RUN_VERSIONS(run_tri_sse2, TARGET_SSE2, run_sse2_body, false, BLEP_TRI)
+DEF_RUN_VERSIONS(run_env_tri_sse2, TARGET_SSE2, run_sse2_body, true, BLEP_TRI)
+DEF_ROT_VERSIONS(run_rot_sse2, TARGET_SSE2, run_rot_sse2_body, false)
+DEF_ROT_VERSIONS(run_env_rot_sse2, TARGET_SSE2, run_rot_sse2_body, true)
+DEF_BANK(run_bank_sse2, TARGET_SSE2, run_bank_sse2_body)
+
+/*
+ * AVX2 version.
+ */
+
+/*
+ * Convert to 32-bit integers, rounding like lrintf() and wrapping around
+ * like a conversion from long would.
+ */
+static sauAlwaysInline TARGET_AVX2 __m256i cvt_wrap_avx2(__m256 x) {
+	__m256 wraps = _mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_mul_ps(x,
+				_mm256_set1_ps(1.f / 4294967296.f))));
+	x = _mm256_sub_ps(x, _mm256_mul_ps(wraps,
+				_mm256_set1_ps(4294967296.f)));
+	return _mm256_cvtps_epi32(x);
+}
+
+/*
+ * Get next 8 phase values, advancing \p phase (all lanes equal).
+ */
+static sauAlwaysInline TARGET_AVX2 __m256i next_phase_avx2(
+		__m256i *restrict phase, __m256 coeff,
+		const float *restrict freq) {
+	__m256i inc = cvt_wrap_avx2(_mm256_mul_ps(coeff,
+				_mm256_loadu_ps(freq)));
+	/* prefix sum within each 128-bit half, then carry low to high */
+	__m256i sum = _mm256_add_epi32(inc, _mm256_slli_si256(inc, 4));
+	sum = _mm256_add_epi32(sum, _mm256_slli_si256(sum, 8));
+	__m256i carry = _mm256_shuffle_epi32(sum, 0xFF);
+	sum = _mm256_add_epi32(sum,
+			_mm256_permute2x128_si256(carry, carry, 0x08));
+	__m256i ph = _mm256_add_epi32(*phase, _mm256_sub_epi32(sum, inc));
+	*phase = _mm256_add_epi32(*phase, _mm256_permutevar8x32_epi32(sum,
+				_mm256_set1_epi32(7)));
+	return ph;
+}
+
+/*
+ * Get 8 LUT values using linear interpolation.
+ *
+ * Each LUT entry is gathered whole, the indices arranged so that
+ * separating the values and differences gives them in order. (For
+ * SAU_WAVE_INT16, a single gather of 32-bit entries is enough.)
+ */
+static sauAlwaysInline TARGET_AVX2 __m256 get_lerp_avx2(
+		const SAU_WaveVal *restrict lut, __m256i phase) {
+	const __m256 fscale = _mm256_set1_ps(1.f / SAU_Wave_SCALE);
+#if SAU_WAVE_INT16
+	__m256i e = _mm256_i32gather_epi32((const int*) lut,
+			_mm256_srli_epi32(phase, SAU_Wave_SCALEBITS),
+			sizeof(SAU_WaveVal));
+	__m256 v = _mm256_cvtepi32_ps(_mm256_srai_epi32(
+				_mm256_slli_epi32(e, 16), 16));
+	__m256 d = _mm256_cvtepi32_ps(_mm256_srai_epi32(e, 16));
+	__m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase,
+				_mm256_set1_epi32(SAU_Wave_SCALEMASK))), fscale);
+	return _mm256_mul_ps(_mm256_add_ps(v, _mm256_mul_ps(d, x)),
+			_mm256_set1_ps(SAU_Wave_VALSCALE));
+#else
+	__m256i ind = _mm256_permutevar8x32_epi32(
+			_mm256_srli_epi32(phase, SAU_Wave_SCALEBITS),
+			_mm256_set_epi32(7, 6, 3, 2, 5, 4, 1, 0));
+	__m256 e0145 = _mm256_castpd_ps(_mm256_i32gather_pd(
+				(const double*) lut,
+				_mm256_castsi256_si128(ind),
+				sizeof(SAU_WaveVal)));
+	__m256 e2367 = _mm256_castpd_ps(_mm256_i32gather_pd(
+				(const double*) lut,
+				_mm256_extracti128_si256(ind, 1),
+				sizeof(SAU_WaveVal)));
+	__m256 v = _mm256_shuffle_ps(e0145, e2367, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 d = _mm256_shuffle_ps(e0145, e2367, _MM_SHUFFLE(3, 1, 3, 1));
+	__m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase,
+				_mm256_set1_epi32(SAU_Wave_SCALEMASK))), fscale);
+	return _mm256_add_ps(v, _mm256_mul_ps(d, x));
+#endif
+}
+
+/*
+ * Convert 8 phase values to 0.0 - 1.0 range, like PHASE_F().
+ */
+static sauAlwaysInline TARGET_AVX2 __m256 phase_f_avx2(__m256i phase) {
+	__m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(phase, 16));
+	__m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(phase,
+				_mm256_set1_epi32(0xFFFF)));
+	return _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(hi,
+					_mm256_set1_ps(65536.f)), lo),
+			_mm256_set1_ps(1.f / 4294967296.f));
+}
+
+/*
+ * PolyBLEP residual for 8 values, like poly_blep().
+ */
+static sauAlwaysInline TARGET_AVX2 __m256 poly_blep_avx2(__m256 t,
+		__m256 dt, __m256 dt_r) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	__m256 x = _mm256_mul_ps(t, dt_r);
+	__m256 r = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(x, x),
+				_mm256_mul_ps(x, x)), one);
+	x = _mm256_mul_ps(_mm256_sub_ps(t, one), dt_r);
+	__m256 r2 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(x, x), x), x), one);
+	r2 = _mm256_and_ps(_mm256_cmp_ps(t, _mm256_sub_ps(one, dt),
+				_CMP_GT_OQ), r2);
+	return _mm256_blendv_ps(r2, r, _mm256_cmp_ps(t, dt, _CMP_LT_OQ));
+}
+
+/*
+ * PolyBLAMP residual for 8 values, like poly_blamp().
+ */
+static sauAlwaysInline TARGET_AVX2 __m256 poly_blamp_avx2(__m256 t,
+		__m256 dt, __m256 dt_r) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	__m256 m = _mm256_cmp_ps(t, dt, _CMP_LT_OQ);
+	__m256 m2 = _mm256_cmp_ps(t, _mm256_sub_ps(one, dt), _CMP_GT_OQ);
+	__m256 x = _mm256_blendv_ps(
+			_mm256_sub_ps(one, _mm256_mul_ps(_mm256_sub_ps(one, t),
+					dt_r)),
+			_mm256_sub_ps(one, _mm256_mul_ps(t, dt_r)), m);
+	x = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(x, x), x),
+			_mm256_set1_ps(1.f/6));
+	return _mm256_and_ps(_mm256_or_ps(m, m2), x);
+}
+
+/*
+ * Get 8 samples of \p w (BLEP_*) wave, like get_blep().
+ */
+static sauAlwaysInline TARGET_AVX2 __m256 get_blep_avx2(uint32_t w,
+		__m256i phase, __m256 dt, __m256 dt_r) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 t = phase_f_avx2(phase);
+	__m256 s, s2, t2, t3;
+	__m256i q;
+	switch (w) {
+	case BLEP_SQR:
+		s = _mm256_or_ps(_mm256_castsi256_ps(_mm256_and_si256(phase,
+					_mm256_set1_epi32(0x80000000))), one);
+		t2 = _mm256_add_ps(t, _mm256_mul_ps(s, _mm256_set1_ps(0.5f)));
+		s = _mm256_add_ps(s, poly_blep_avx2(t, dt, dt_r));
+		s = _mm256_sub_ps(s, poly_blep_avx2(t2, dt, dt_r));
+		break;
+	case BLEP_SAW:
+		s = _mm256_sub_ps(one, _mm256_add_ps(t, t));
+		s = _mm256_add_ps(s, poly_blep_avx2(t, dt, dt_r));
+		break;
+	default: /* BLEP_TRI */
+		s = _mm256_mul_ps(t, _mm256_set1_ps(4.f));
+		q = _mm256_srli_epi32(phase, 30);
+		s2 = _mm256_blendv_ps(_mm256_sub_ps(_mm256_set1_ps(2.f), s), s,
+				_mm256_castsi256_ps(_mm256_cmpeq_epi32(q,
+						_mm256_setzero_si256())));
+		s = _mm256_blendv_ps(s2, _mm256_sub_ps(s, _mm256_set1_ps(4.f)),
+				_mm256_castsi256_ps(_mm256_cmpeq_epi32(q,
+						_mm256_set1_epi32(3))));
+		t2 = _mm256_sub_ps(t, _mm256_set1_ps(0.25f));
+		t2 = _mm256_add_ps(t2, _mm256_and_ps(_mm256_cmp_ps(t2,
+						_mm256_setzero_ps(), _CMP_LT_OQ),
+					one));
+		t3 = _mm256_add_ps(t, _mm256_set1_ps(0.25f));
+		t3 = _mm256_sub_ps(t3, _mm256_and_ps(_mm256_cmp_ps(t3, one,
+						_CMP_GE_OQ), one));
+		s2 = _mm256_sub_ps(poly_blamp_avx2(t2, dt, dt_r),
+				poly_blamp_avx2(t3, dt, dt_r));
+		s = _mm256_sub_ps(s, _mm256_mul_ps(_mm256_mul_ps(
+					_mm256_set1_ps(8.f), dt), s2));
+		break;
+	}
+	return s;
+}
+
+/*
+ * Generate 8 samples at a time for loop version \p v and wave \p w.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_AVX2 size_t run_avx2_body(
+		SAU_Osc *restrict o,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env, uint32_t w,
+		const float *restrict freq,
+		const float *restrict amp,
+		const float *restrict pm_f) {
+	const __m256 coeff = _mm256_set1_ps(o->coeff);
+	const __m256 pm_scale = _mm256_set1_ps((float) INT32_MAX);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 abs_mask = _mm256_castsi256_ps(
+			_mm256_set1_epi32(INT32_MAX));
+	const SAU_WaveVal *restrict lut = o->lut;
+	__m256i phase = _mm256_set1_epi32(o->phase);
+	__m256i inc_offs = _mm256_setzero_si256(), inc_step = inc_offs;
+	__m256 dt = _mm256_setzero_ps(), dt_r = dt;
+	__m256 s_amp = _mm256_setzero_ps();
+	if (v & V_FREQ_CONST) {
+		uint32_t inc = lrintf(o->coeff * freq[0]);
+		inc_offs = _mm256_mullo_epi32(_mm256_set1_epi32(inc),
+				_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+		inc_step = _mm256_set1_epi32(inc * 8);
+		if (w != LUT_WAVE) {
+			float dt_s = PHASE_F(fabsf(o->coeff * freq[0]));
+			dt = _mm256_set1_ps(dt_s);
+			dt_r = _mm256_set1_ps(1.f / dt_s);
+		}
+	}
+	if (v & V_AMP_CONST) s_amp = _mm256_set1_ps(amp[0]);
+	size_t i, end = buf_len & ~(size_t) 7;
+	for (i = 0; i < end; i += 8) {
+		__m256i ph;
+		if (v & V_FREQ_CONST) {
+			ph = _mm256_add_epi32(phase, inc_offs);
+			phase = _mm256_add_epi32(phase, inc_step);
+		} else {
+			ph = next_phase_avx2(&phase, coeff, &freq[i]);
+			if (w != LUT_WAVE) {
+				dt = _mm256_mul_ps(_mm256_and_ps(_mm256_mul_ps(
+							coeff,
+							_mm256_loadu_ps(&freq[i])),
+						abs_mask),
+					_mm256_set1_ps(1.f / 4294967296.f));
+				dt_r = _mm256_div_ps(_mm256_set1_ps(1.f), dt);
+			}
+		}
+		if (v & V_PM) {
+			__m256 pm = _mm256_mul_ps(_mm256_loadu_ps(&pm_f[i]),
+					pm_scale);
+			ph = _mm256_add_epi32(ph, cvt_wrap_avx2(pm));
+		}
+		__m256 s = (w == LUT_WAVE) ?
+			get_lerp_avx2(lut, ph) :
+			get_blep_avx2(w, ph, dt, dt_r);
+		if (!(v & V_AMP_CONST)) s_amp = _mm256_loadu_ps(&amp[i]);
+		if (!env) {
+			s = _mm256_mul_ps(s, s_amp);
+			if (v & V_LAYER)
+				s = _mm256_add_ps(s, _mm256_loadu_ps(&buf[i]));
+		} else {
+			__m256 s_amp_h = _mm256_mul_ps(s_amp, half);
+			s = _mm256_add_ps(_mm256_mul_ps(s, s_amp_h),
+					_mm256_and_ps(s_amp_h, abs_mask));
+			if (v & V_LAYER)
+				s = _mm256_mul_ps(s, _mm256_loadu_ps(&buf[i]));
+		}
+		_mm256_storeu_ps(&buf[i], s);
+	}
+	o->phase = _mm_cvtsi128_si32(_mm256_castsi256_si128(phase));
+	return end;
+}
+
+/*
+ * Generate 8 samples at a time for panned loop version \p v
+ * and wave \p w, like run_pan_c_body().
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_AVX2 size_t run_pan_avx2_body(
+		SAU_Osc *restrict o,
+		float *restrict buf_l, float *restrict buf_r, size_t buf_len,
+		uint32_t v, uint32_t w,
+		const float *restrict freq,
+		const float *restrict amp,
+		float scale, float pan) {
+	const __m256 coeff = _mm256_set1_ps(o->coeff);
+	const __m256 abs_mask = _mm256_castsi256_ps(
+			_mm256_set1_epi32(INT32_MAX));
+	const __m256 v_scale = _mm256_set1_ps(scale);
+	const __m256 v_pan = _mm256_set1_ps(pan);
+	const SAU_WaveVal *restrict lut = o->lut;
+	__m256i phase = _mm256_set1_epi32(o->phase);
+	__m256i inc_offs = _mm256_setzero_si256(), inc_step = inc_offs;
+	__m256 dt = _mm256_setzero_ps(), dt_r = dt;
+	__m256 s_amp = _mm256_setzero_ps();
+	if (v & V_FREQ_CONST) {
+		uint32_t inc = lrintf(o->coeff * freq[0]);
+		inc_offs = _mm256_mullo_epi32(_mm256_set1_epi32(inc),
+				_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+		inc_step = _mm256_set1_epi32(inc * 8);
+		if (w != LUT_WAVE) {
+			float dt_s = PHASE_F(fabsf(o->coeff * freq[0]));
+			dt = _mm256_set1_ps(dt_s);
+			dt_r = _mm256_set1_ps(1.f / dt_s);
+		}
+	}
+	if (v & V_AMP_CONST) s_amp = _mm256_set1_ps(amp[0]);
+	size_t i, end = buf_len & ~(size_t) 7;
+	for (i = 0; i < end; i += 8) {
+		__m256i ph;
+		if (v & V_FREQ_CONST) {
+			ph = _mm256_add_epi32(phase, inc_offs);
+			phase = _mm256_add_epi32(phase, inc_step);
+		} else {
+			ph = next_phase_avx2(&phase, coeff, &freq[i]);
+			if (w != LUT_WAVE) {
+				dt = _mm256_mul_ps(_mm256_and_ps(_mm256_mul_ps(
+							coeff,
+							_mm256_loadu_ps(&freq[i])),
+						abs_mask),
+					_mm256_set1_ps(1.f / 4294967296.f));
+				dt_r = _mm256_div_ps(_mm256_set1_ps(1.f), dt);
+			}
+		}
+		__m256 s = (w == LUT_WAVE) ?
+			get_lerp_avx2(lut, ph) :
+			get_blep_avx2(w, ph, dt, dt_r);
+		if (!(v & V_AMP_CONST)) s_amp = _mm256_loadu_ps(&amp[i]);
+		s = _mm256_mul_ps(_mm256_mul_ps(s, s_amp), v_scale);
+		__m256 s_r = _mm256_mul_ps(s, v_pan);
+		_mm256_storeu_ps(&buf_l[i], _mm256_add_ps(
+					_mm256_loadu_ps(&buf_l[i]),
+					_mm256_sub_ps(s, s_r)));
+		_mm256_storeu_ps(&buf_r[i], _mm256_add_ps(
+					_mm256_loadu_ps(&buf_r[i]),
+					_mm256_add_ps(s, s_r)));
+	}
+	o->phase = _mm_cvtsi128_si32(_mm256_castsi256_si128(phase));
+	return end;
+}
+
+/*
+ * Generate ROT_LANES samples at a time for rotation sine loop
+ * version \p v, as vectors of 8 lanes.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_AVX2 size_t run_rot_avx2_body(
+		RotSin *restrict r,
+		float *restrict buf, size_t buf_len,
+		uint32_t v, bool env,
+		const float *restrict amp) {
+	enum { N = ROT_LANES / 8 };
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 abs_mask = _mm256_castsi256_ps(
+			_mm256_set1_epi32(INT32_MAX));
+	const __m256 rot_re = _mm256_set1_ps(r->rot_re);
+	const __m256 rot_im = _mm256_set1_ps(r->rot_im);
+	__m256 re[N], im[N];
+	__m256 s_amp = _mm256_setzero_ps();
+	for (int n = 0; n < N; ++n) {
+		re[n] = _mm256_loadu_ps(&r->re[n * 8]);
+		im[n] = _mm256_loadu_ps(&r->im[n * 8]);
+	}
+	if (v & V_AMP_CONST) s_amp = _mm256_set1_ps(amp[0]);
+	size_t i, end = buf_len & ~(size_t) (ROT_LANES - 1);
+	for (i = 0; i < end; i += ROT_LANES) {
+		for (int n = 0; n < N; ++n) {
+			const size_t j = i + n * 8;
+			__m256 s = im[n];
+			__m256 tmp = _mm256_sub_ps(
+					_mm256_mul_ps(re[n], rot_re),
+					_mm256_mul_ps(im[n], rot_im));
+			im[n] = _mm256_add_ps(_mm256_mul_ps(re[n], rot_im),
+					_mm256_mul_ps(im[n], rot_re));
+			re[n] = tmp;
+			if (!(v & V_AMP_CONST))
+				s_amp = _mm256_loadu_ps(&amp[j]);
+			if (!env) {
+				s = _mm256_mul_ps(s, s_amp);
+				if (v & V_LAYER)
+					s = _mm256_add_ps(s,
+							_mm256_loadu_ps(&buf[j]));
+			} else {
+				__m256 s_amp_h = _mm256_mul_ps(s_amp, half);
+				s = _mm256_add_ps(_mm256_mul_ps(s, s_amp_h),
+						_mm256_and_ps(s_amp_h,
+							abs_mask));
+				if (v & V_LAYER)
+					s = _mm256_mul_ps(s,
+							_mm256_loadu_ps(&buf[j]));
+			}
+			_mm256_storeu_ps(&buf[j], s);
+		}
+	}
+	for (int n = 0; n < N; ++n) {
+		_mm256_storeu_ps(&r->re[n * 8], re[n]);
+		_mm256_storeu_ps(&r->im[n * 8], im[n]);
+	}
+	return end;
+}
+
+/*
+ * Generate BANK_STEP samples at a time for sine bank loop, adding
+ * to \p buf unless \p add is false. The lanes are held in vectors
+ * of 8, summed pairwise using horizontal adds.
+ *
+ * \return number of samples generated
+ */
+static sauAlwaysInline TARGET_AVX2 size_t run_bank_avx2_body(
+		SinBank *restrict b,
+		float *restrict buf, size_t buf_len, bool add) {
+	const __m256 rot_re = _mm256_loadu_ps(b->rot_re);
+	const __m256 rot_im = _mm256_loadu_ps(b->rot_im);
+	__m256 re[BANK_STEP], im[BANK_STEP];
+	for (int t = 0; t < BANK_STEP; ++t) {
+		re[t] = _mm256_loadu_ps(b->re[t]);
+		im[t] = _mm256_loadu_ps(b->im[t]);
+	}
+	size_t i, end = buf_len & ~(size_t) (BANK_STEP - 1);
+	for (i = 0; i < end; i += BANK_STEP) {
+		__m256 s[BANK_STEP];
+		for (int t = 0; t < BANK_STEP; ++t) {
+			s[t] = im[t];
+			__m256 tmp = _mm256_sub_ps(
+					_mm256_mul_ps(re[t], rot_re),
+					_mm256_mul_ps(im[t], rot_im));
+			im[t] = _mm256_add_ps(_mm256_mul_ps(re[t], rot_im),
+					_mm256_mul_ps(im[t], rot_re));
+			re[t] = tmp;
+		}
+		for (int t = 0; t < 4; ++t)
+			s[t] = _mm256_hadd_ps(s[t * 2], s[t * 2 + 1]);
+		s[0] = _mm256_hadd_ps(s[0], s[1]);
+		s[1] = _mm256_hadd_ps(s[2], s[3]);
+		__m256 sum = _mm256_add_ps(
+				_mm256_permute2f128_ps(s[0], s[1], 0x20),
+				_mm256_permute2f128_ps(s[0], s[1], 0x31));
+		if (add) sum = _mm256_add_ps(_mm256_loadu_ps(&buf[i]), sum);
+		_mm256_storeu_ps(&buf[i], sum);
+	}
+	for (int t = 0; t < BANK_STEP; ++t) {
+		_mm256_storeu_ps(b->re[t], re[t]);
+		_mm256_storeu_ps(b->im[t], im[t]);
+	}
+	return end;
+}
+
+DEF_RUN_VERSIONS(run_avx2, TARGET_AVX2, run_avx2_body, false, LUT_WAVE)
+DEF_RUN_VERSIONS(run_env_avx2, TARGET_AVX2, run_avx2_body, true, LUT_WAVE)
+DEF_RUN_VERSIONS(run_sqr_avx2, TARGET_AVX2, run_avx2_body, false, BLEP_SQR)
+DEF_RUN_VERSIONS(run_env_sqr_avx2, TARGET_AVX2, run_avx2_body, true, BLEP_SQR)
+DEF_RUN_VERSIONS(run_saw_avx2, TARGET_AVX2, run_avx2_body, false, BLEP_SAW)
+DEF_RUN_VERSIONS(run_env_saw_avx2, TARGET_AVX2, run_avx2_body, true, BLEP_SAW)
+DEF_RUN_VERSIONS(run_tri_avx2, TARGET_AVX2, run_avx2_body, false, BLEP_TRI)
+DEF_RUN_VERSIONS(run_env_tri_avx2, TARGET_AVX2, run_avx2_body, true, BLEP_TRI)
+DEF_ROT_VERSIONS(run_rot_avx2, TARGET_AVX2, run_rot_avx2_body, false)
+DEF_ROT_VERSIONS(run_env_rot_avx2, TARGET_AVX2, run_rot_avx2_body, true)
+DEF_BANK(run_bank_avx2, TARGET_AVX2, run_bank_avx2_body)
+DEF_PAN_VERSIONS(run_pan_sqr_avx2, TARGET_AVX2, run_pan_avx2_body, BLEP_SQR)
+DEF_PAN_VERSIONS(run_pan_saw_avx2, TARGET_AVX2, run_pan_avx2_body, BLEP_SAW)
+DEF_PAN_VERSIONS(run_pan_tri_avx2, TARGET_AVX2, run_pan_avx2_body, BLEP_TRI)
+DEF_ROT_PAN_VERSIONS(run_rot_pan_avx2, TARGET_AVX2)
+
+/*
+ * Pick the best versions supported by the CPU.
+ */
+static void init_x86(void) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		run_fs = run_avx2_fs;
+		run_env_fs = run_env_avx2_fs;
+		rot_fs = run_rot_avx2_fs;
+		rot_env_fs = run_env_rot_avx2_fs;
+		bank_fs = run_bank_avx2_fs;
+		rot_pan_fs = run_rot_pan_avx2_fs;
+		blep_fs[SAU_WAVE_SQR] = run_sqr_avx2_fs;
+		blep_fs[SAU_WAVE_TRI] = run_tri_avx2_fs;
+		blep_fs[SAU_WAVE_SAW] = run_saw_avx2_fs;
+		blep_env_fs[SAU_WAVE_SQR] = run_env_sqr_avx2_fs;
+		blep_env_fs[SAU_WAVE_TRI] = run_env_tri_avx2_fs;
+		blep_env_fs[SAU_WAVE_SAW] = run_env_saw_avx2_fs;
+		blep_pan_fs[SAU_WAVE_SQR] = run_pan_sqr_avx2_fs;
+		blep_pan_fs[SAU_WAVE_TRI] = run_pan_tri_avx2_fs;
+		blep_pan_fs[SAU_WAVE_SAW] = run_pan_saw_avx2_fs;
+	} else if (__builtin_cpu_supports("sse2")) {
+		run_fs = run_sse2_fs;
+		run_env_fs = run_env_sse2_fs;
+		rot_fs = run_rot_sse2_fs;
+		rot_env_fs = run_env_rot_sse2_fs;
+		bank_fs = run_bank_sse2_fs;
+		blep_fs[SAU_WAVE_SQR] = run_sqr_sse2_fs;
+		blep_fs[SAU_WAVE_TRI] = run_tri_sse2_fs;
+		blep_fs[SAU_WAVE_SAW] = run_saw_sse2_fs;
+		blep_env_fs[SAU_WAVE_SQR] = run_env_sqr_sse2_fs;
+		blep_env_fs[SAU_WAVE_TRI] = run_env_tri_sse2_fs;
+		blep_env_fs[SAU_WAVE_SAW] = run_env_saw_sse2_fs;
+	}
+}
@@ -13,43 +13,100 @@
 
 #include "prealloc.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 /*
  * Voice graph traverser and data allocator.
  */
 
 static bool traverse_op_node(SAU_PreAlloc *restrict o,
-		SAU_ProgramOpRef *restrict op_ref);
+		SAU_ProgramOpRef *restrict op_ref,
+		uint32_t parent, uint32_t list_ind, uint16_t buf);
 
 /*
  * Traverse operator list, as part of building a graph for the voice.
+ * Schedule nodes for the operators get \p parent, and output to
+ * buffer \p buf.
  *
  * \return true, or false on allocation failure
  */
 static bool traverse_op_list(SAU_PreAlloc *restrict o,
-		const SAU_ProgramOpList *restrict op_list, uint8_t mod_use) {
+		const SAU_ProgramOpList *restrict op_list, uint8_t mod_use,
+		uint32_t parent, uint16_t buf) {
 	SAU_ProgramOpRef op_ref = {0, mod_use, o->vg.nest_level};
 	for (uint32_t i = 0; i < op_list->count; ++i) {
 		op_ref.id = op_list->ids[i];
-		if (!traverse_op_node(o, &op_ref))
+		if (!traverse_op_node(o, &op_ref, parent, i, buf))
 			return false;
 	}
 	return true;
 }
 
+/*
+ * Add run schedule step of \p type for node \p node.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool add_run_step(SAU_PreAlloc *restrict o,
+		uint32_t node, uint8_t type) {
+	RunStep step = {node, type};
+	return RunStepArr_add(&o->vg.sched_steps, &step) != NULL;
+}
+
+/*
+ * Allot a buffer, re-using the one freed last if any.
+ *
+ * \return buffer number
+ */
+static uint16_t get_buf(SAU_PreAlloc *restrict o) {
+	BufSlotArr *free_bufs = &o->vg.free_bufs;
+	if (free_bufs->count > 0)
+		return free_bufs->a[--free_bufs->count];
+	return o->vg.buf_count++;
+}
+
+/*
+ * Free buffer \p buf, making it available for re-use
+ * by steps following those which use it.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool put_buf(SAU_PreAlloc *restrict o, uint16_t buf) {
+	return BufSlotArr_add(&o->vg.free_bufs, &buf) != NULL;
+}
+
 /*
  * Traverse parts of voice operator graph reached from operator node,
  * adding reference after traversal of modulator lists.
  *
+ * Also adds the schedule node and steps for running the operator,
+ * allotting buffers for it and its modulators as they become live
+ * and freeing them after the last step using them. The output goes
+ * to \p buf, which belongs to the parent.
+ *
  * \return true, or false on allocation failure
  */
 static bool traverse_op_node(SAU_PreAlloc *restrict o,
-		SAU_ProgramOpRef *restrict op_ref) {
+		SAU_ProgramOpRef *restrict op_ref,
+		uint32_t parent, uint32_t list_ind, uint16_t buf) {
 	OperatorNode *on = &o->operators[op_ref->id];
+	RunNodeArr *nodes = &o->vg.sched_nodes;
+	uint32_t id = nodes->count;
+	RunNode rn = {0};
+	rn.op_id = op_ref->id;
+	rn.parent = parent;
+	rn.list_ind = list_ind;
+	rn.use = op_ref->use;
+	rn.level = o->vg.nest_level;
+	rn.s_buf = buf;
+	if (!RunNodeArr_add(nodes, &rn) || !add_run_step(o, id, RUN_BEGIN))
+		return false;
 	if (on->flags & ON_VISITED) {
 		SAU_warning("voicegraph",
 "skipping operator %d; circular references unsupported",
 			op_ref->id);
+		nodes->a[id].circular = true;
+		nodes->a[id].end = o->vg.sched_steps.count;
 		return true;
 	}
 	if (o->vg.nest_level > o->vg.nest_max) {
@@ -57,12 +114,45 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
 	}
 	++o->vg.nest_level;
 	on->flags |= ON_VISITED;
-	if (!traverse_op_list(o, on->fmods, SAU_POP_FMOD))
+	nodes->a[id].freq = get_buf(o);
+	if (on->fmods->count > 0) {
+		nodes->a[id].freq2 = get_buf(o);
+		nodes->a[id].fm = get_buf(o);
+		if (!traverse_op_list(o, on->fmods, SAU_POP_FMOD, id,
+					nodes->a[id].fm))
+			return false;
+		if (!put_buf(o, nodes->a[id].fm) ||
+		    !put_buf(o, nodes->a[id].freq2))
+			return false;
+	}
+	if (!add_run_step(o, id, RUN_FREQ))
+		return false;
+	if (on->pmods->count > 0) {
+		nodes->a[id].pm = get_buf(o);
+		if (!traverse_op_list(o, on->pmods, SAU_POP_PMOD, id,
+					nodes->a[id].pm))
+			return false;
+	}
+	if (!add_run_step(o, id, RUN_AMP))
 		return false;
-	if (!traverse_op_list(o, on->pmods, SAU_POP_PMOD))
+	nodes->a[id].amp = get_buf(o);
+	if (on->amods->count > 0) {
+		nodes->a[id].amp2 = get_buf(o);
+		nodes->a[id].am = get_buf(o);
+		if (!traverse_op_list(o, on->amods, SAU_POP_AMOD, id,
+					nodes->a[id].am))
+			return false;
+		if (!put_buf(o, nodes->a[id].am) ||
+		    !put_buf(o, nodes->a[id].amp2))
+			return false;
+	}
+	if (!add_run_step(o, id, RUN_OSC))
 		return false;
-	if (!traverse_op_list(o, on->amods, SAU_POP_AMOD))
+	if (!put_buf(o, nodes->a[id].amp) ||
+	    (on->pmods->count > 0 && !put_buf(o, nodes->a[id].pm)) ||
+	    !put_buf(o, nodes->a[id].freq))
 		return false;
+	nodes->a[id].end = o->vg.sched_steps.count;
 	on->flags &= ~ON_VISITED;
 	--o->vg.nest_level;
 	if (!SAU_OpRefArr_add(&o->vg.vo_graph, op_ref))
@@ -70,10 +160,125 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
 	return true;
 }
 
+/*
+ * Link schedule nodes which are further uses of a modulator to the
+ * first node for it, allotting the buffers for keeping its output
+ * in the first, and its parent frequency if it may be relative.
+ * Uses within the modulators of a node which is such a further
+ * use aren't linked, as they are only run if it is.
+ */
+static void link_shared_nodes(SAU_PreAlloc *restrict o) {
+	RunNodeArr *nodes = &o->vg.sched_nodes;
+	uint32_t i;
+	for (i = 0; i < nodes->count; ++i) {
+		RunNode *rn = &nodes->a[i];
+		rn->first = i;
+		if (rn->parent == RUN_NO_PARENT || rn->circular)
+			continue;
+		if (nodes->a[rn->parent].first != rn->parent)
+			continue;
+		OperatorNode *on = &o->operators[rn->op_id];
+		if (!(on->flags & ON_SCHEDULED)) {
+			on->flags |= ON_SCHEDULED;
+			on->sched_node = i;
+			continue;
+		}
+		RunNode *first_rn = &nodes->a[on->sched_node];
+		rn->first = on->sched_node;
+		if (!first_rn->out) {
+			first_rn->out = o->vg.buf_count++;
+			/* parent frequency only matters if relative */
+			if (on->flags & ON_FREQ_RATIO)
+				first_rn->key = o->vg.buf_count++;
+		}
+	}
+	for (i = 0; i < nodes->count; ++i)
+		o->operators[nodes->a[i].op_id].flags &= ~ON_SCHEDULED;
+}
+
+/*
+ * Minimum number of nodes in a modulator subtree for it to count
+ * as worth running as a task, in parallel with other subtrees.
+ */
+#define TASK_MIN_NODES 8
+
+/*
+ * Check whether any of the schedule nodes from \p node until
+ * \p end use an operator which has other nodes.
+ */
+static bool has_multiuse(SAU_PreAlloc *restrict o,
+		uint32_t node, uint32_t end) {
+	const RunNode *nodes = o->vg.sched_nodes.a;
+	for (; node < end; ++node)
+		if (o->operators[nodes[node].op_id].flags & ON_MULTIUSE)
+			return true;
+	return false;
+}
+
+/*
+ * Mark modulator lists which may be run with each subtree as a
+ * task, in parallel. Such a list must have at least two subtrees
+ * of TASK_MIN_NODES or more nodes, and no operators used outside
+ * of their own subtrees; otherwise it's left to be run serially.
+ *
+ * Relies on nodes being numbered in the order of traversal, so
+ * that each subtree has a range of nodes.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool mark_task_lists(SAU_PreAlloc *restrict o) {
+	RunNodeArr *nodes = &o->vg.sched_nodes;
+	NodeCountArr *sizes = &o->vg.subtree_sizes;
+	uint32_t i;
+	if (!NodeCountArr_upsize(sizes, nodes->count))
+		return false;
+	for (i = 0; i < nodes->count; ++i) {
+		OperatorNode *on = &o->operators[nodes->a[i].op_id];
+		if (on->flags & ON_SCHEDULED)
+			on->flags |= ON_MULTIUSE;
+		on->flags |= ON_SCHEDULED;
+		sizes->a[i] = 1;
+	}
+	for (i = nodes->count; i-- > 0; ) {
+		uint32_t parent = nodes->a[i].parent;
+		if (parent != RUN_NO_PARENT)
+			sizes->a[parent] += sizes->a[i];
+	}
+	for (i = 0; i < nodes->count; ++i) {
+		RunNode *rn = &nodes->a[i];
+		uint32_t end = i + sizes->a[i];
+		for (uint32_t mod = i + 1; mod < end; ) {
+			uint8_t use = nodes->a[mod].use;
+			uint32_t count = 0, large_count = 0;
+			bool multiuse = false;
+			for (; mod < end && nodes->a[mod].use == use;
+					mod += sizes->a[mod]) {
+				uint32_t mod_end = mod + sizes->a[mod];
+				++count;
+				if (sizes->a[mod] >= TASK_MIN_NODES)
+					++large_count;
+				if (!multiuse)
+					multiuse = has_multiuse(o, mod, mod_end);
+			}
+			if (large_count < 2 || multiuse)
+				continue;
+			rn->par_uses |= 1 << use;
+			if (count > o->max_tasks)
+				o->max_tasks = count;
+		}
+	}
+	for (i = 0; i < nodes->count; ++i)
+		o->operators[nodes->a[i].op_id].flags &=
+			~(ON_SCHEDULED | ON_MULTIUSE);
+	return true;
+}
+
 /*
  * Create operator graph for voice using data built
  * during allocation, assigning an operator reference
  * list to the voice and block IDs to the operators.
+ * Also assigns the run schedule for the graph, and
+ * updates the peak number of buffers needed.
  *
  * \return true, or false on allocation failure
  */
@@ -81,42 +286,175 @@ static bool set_voice_graph(SAU_PreAlloc *restrict o,
 		const SAU_ProgramVoData *restrict pvd,
 		EventNode *restrict ev) {
 	if (!pvd->carriers->count) goto DONE;
-	if (!traverse_op_list(o, pvd->carriers, SAU_POP_CARR))
+	o->vg.buf_count = 1; // first buffer for carrier output
+	if (!traverse_op_list(o, pvd->carriers, SAU_POP_CARR,
+				RUN_NO_PARENT, 0))
+		return false;
+	link_shared_nodes(o);
+	if (!mark_task_lists(o))
 		return false;
 	if (!SAU_OpRefArr_mpmemdup(&o->vg.vo_graph,
 				(SAU_ProgramOpRef**) &ev->graph, o->mem))
 		return false;
 	ev->graph_count = o->vg.vo_graph.count;
+	if (!RunNodeArr_mpmemdup(&o->vg.sched_nodes,
+				(RunNode**) &ev->sched.nodes, o->mem) ||
+	    !RunStepArr_mpmemdup(&o->vg.sched_steps,
+				(RunStep**) &ev->sched.steps, o->mem))
+		return false;
+	ev->sched.node_count = o->vg.sched_nodes.count;
+	ev->sched.step_count = o->vg.sched_steps.count;
+	if (ev->sched.node_count > o->max_nodes)
+		o->max_nodes = ev->sched.node_count;
+	if (o->vg.buf_count > o->max_bufs)
+		o->max_bufs = o->vg.buf_count;
 DONE:
 	o->vg.vo_graph.count = 0; // re-use allocation
+	o->vg.sched_nodes.count = 0;
+	o->vg.sched_steps.count = 0;
+	o->vg.free_bufs.count = 0;
 	return true;
 }
 
 /*
- * Main interpreter pre-allocation code.
+ * Voice timing, for the peak number of voices playing at once.
+ *
+ * Follows the time parameters of operators through the events,
+ * like the interpreter does when setting voice durations. Each
+ * span of time a voice plays for is recorded as a start and an
+ * end, counted after all events have been gone through.
+ */
+
+/*
+ * Record the current span of voice \p vo_id as ending at the
+ * earliest of its end and \p pos, if it has a length.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool end_voice_span(SAU_PreAlloc *restrict o,
+		uint16_t vo_id, uint64_t pos) {
+	SAU_VoiceTiming *vt = &o->vt;
+	uint64_t start = vt->vo_starts[vo_id], end = vt->vo_ends[vo_id];
+	if (end > pos)
+		end = pos;
+	if (end <= start)
+		return true;
+	/* starts sort after ends at the same position */
+	uint64_t edge = (start << 1) | 1;
+	if (!SpanEdgeArr_add(&vt->edges, &edge))
+		return false;
+	edge = end << 1;
+	if (!SpanEdgeArr_add(&vt->edges, &edge))
+		return false;
+	vt->vo_ends[vo_id] = vt->vo_starts[vo_id] = 0;
+	return true;
+}
+
+/*
+ * Update timing for event \p e, at the current position.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool time_event(SAU_PreAlloc *restrict o,
+		const EventNode *restrict e) {
+	SAU_VoiceTiming *vt = &o->vt;
+	const SAU_ProgramEvent *prg_e = e->prg_e;
+	vt->pos += e->wait;
+	for (size_t i = 0; i < prg_e->op_data_count; ++i) {
+		const SAU_ProgramOpData *od = &prg_e->op_data[i];
+		if (!(od->params & SAU_POPP_TIME))
+			continue;
+		vt->op_ends[od->id] = vt->pos;
+		if (!(od->time.flags & SAU_TIMEP_LINKED))
+			vt->op_ends[od->id] +=
+				SAU_MS_IN_SAMPLES(od->time.v_ms, o->srate);
+	}
+	uint16_t vo_id = prg_e->vo_id;
+	if (vo_id == SAU_PVO_NO_ID)
+		return true;
+	if (e->graph != NULL)
+		vt->vo_graph_evs[vo_id] = e;
+	const EventNode *graph_e = vt->vo_graph_evs[vo_id];
+	uint64_t end = vt->pos;
+	for (uint32_t i = 0; graph_e && i < graph_e->graph_count; ++i) {
+		const SAU_ProgramOpRef *or = &graph_e->graph[i];
+		if (or->use != SAU_POP_CARR) continue;
+		if (vt->op_ends[or->id] > end)
+			end = vt->op_ends[or->id];
+	}
+	if (!end_voice_span(o, vo_id, vt->pos))
+		return false;
+	vt->vo_starts[vo_id] = vt->pos;
+	vt->vo_ends[vo_id] = end;
+	return true;
+}
+
+static int cmp_edges(const void *restrict a, const void *restrict b) {
+	uint64_t ea = *(const uint64_t*) a, eb = *(const uint64_t*) b;
+	return (ea > eb) - (ea < eb);
+}
+
+/*
+ * End all voice spans and count the peak number playing at once.
+ *
+ * \return true, or false on allocation failure
  */
+static bool count_active(SAU_PreAlloc *restrict o) {
+	SAU_VoiceTiming *vt = &o->vt;
+	for (uint16_t i = 0; i < o->vo_count; ++i)
+		if (!end_voice_span(o, i, UINT64_MAX))
+			return false;
+	qsort(vt->edges.a, vt->edges.count, sizeof(*vt->edges.a),
+			cmp_edges);
+	uint32_t count = 0;
+	for (size_t i = 0; i < vt->edges.count; ++i) {
+		if (!(vt->edges.a[i] & 1)) {
+			--count;
+			continue;
+		}
+		if (++count > o->max_active)
+			o->max_active = count;
+	}
+	return true;
+}
 
-// maximum number of buffers needed for op nesting depth
-#define COUNT_BUFS(op_nest_depth) ((1 + (op_nest_depth)) * 7)
+/*
+ * Main interpreter pre-allocation code.
+ */
 
 static void init_operators(SAU_PreAlloc *restrict o) {
-	for (size_t i = 0; i < o->prg->op_count; ++i) {
+	const uint8_t ratio = SAU_RAMPP_STATE_RATIO | SAU_RAMPP_GOAL_RATIO;
+	const SAU_Program *prg = o->prg;
+	for (size_t i = 0; i < prg->op_count; ++i) {
 		OperatorNode *on = &o->operators[i];
 		SAU_init_Osc(&on->osc, o->srate);
 	}
+	/*
+	 * Mark operators given a relative frequency by any event.
+	 */
+	for (size_t i = 0; i < prg->ev_count; ++i) {
+		const SAU_ProgramEvent *prg_e = prg->events[i];
+		for (size_t j = 0; j < prg_e->op_data_count; ++j) {
+			const SAU_ProgramOpData *od = &prg_e->op_data[j];
+			uint8_t flags = 0;
+			if (od->params & SAU_POPP_FREQ)
+				flags |= od->freq.flags;
+			if (od->params & SAU_POPP_FREQ2)
+				flags |= od->freq2.flags;
+			if (flags & ratio)
+				o->operators[od->id].flags |= ON_FREQ_RATIO;
+		}
+	}
 }
 
 static bool init_events(SAU_PreAlloc *restrict o) {
 	const SAU_Program *prg = o->prg;
-	uint32_t vo_wait_time = 0;
 	for (size_t i = 0; i < prg->ev_count; ++i) {
 		const SAU_ProgramEvent *prg_e = prg->events[i];
 		EventNode *e = SAU_MemPool_alloc(o->mem, sizeof(EventNode));
 		if (!e)
 			return false;
-		uint16_t vo_id = prg_e->vo_id;
 		e->wait = SAU_MS_IN_SAMPLES(prg_e->wait_ms, o->srate);
-		vo_wait_time += e->wait;
 		e->prg_e = prg_e;
 		for (size_t i = 0; i < prg_e->op_data_count; ++i) {
 			const SAU_ProgramOpData *od = &prg_e->op_data[i];
@@ -135,12 +473,12 @@ static bool init_events(SAU_PreAlloc *restrict o) {
 				if (!set_voice_graph(o, pvd, e))
 					return false;
 			}
-			o->voices[vo_id].pos = -vo_wait_time;
-			vo_wait_time = 0;
 		}
+		if (!time_event(o, e))
+			return false;
 		o->events[i] = e;
 	}
-	return true;
+	return count_active(o);
 }
 
 /*
@@ -188,6 +526,15 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 				i * sizeof(VoiceNode));
 		if (!o->voices) goto MEM_ERR;
 		o->vo_count = i;
+		o->vt.vo_starts = calloc(i, sizeof(uint64_t));
+		o->vt.vo_ends = calloc(i, sizeof(uint64_t));
+		o->vt.vo_graph_evs = calloc(i, sizeof(EventNode*));
+		if (!o->vt.vo_starts || !o->vt.vo_ends ||
+		    !o->vt.vo_graph_evs) goto MEM_ERR;
+	}
+	if (o->op_count > 0) {
+		o->vt.op_ends = calloc(o->op_count, sizeof(uint64_t));
+		if (!o->vt.op_ends) goto MEM_ERR;
 	}
 
 	init_operators(o);
@@ -195,12 +542,20 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 	if (!check_validity(o)) {
 		error = true;
 	}
-	o->max_bufs = COUNT_BUFS(o->vg.nest_max);
 	if (false)
 	MEM_ERR: {
 		SAU_error("prealloc", "memory allocation failure");
 		error = true;
 	}
 	SAU_OpRefArr_clear(&o->vg.vo_graph);
+	RunNodeArr_clear(&o->vg.sched_nodes);
+	RunStepArr_clear(&o->vg.sched_steps);
+	BufSlotArr_clear(&o->vg.free_bufs);
+	NodeCountArr_clear(&o->vg.subtree_sizes);
+	free(o->vt.op_ends);
+	free(o->vt.vo_starts);
+	free(o->vt.vo_ends);
+	free(o->vt.vo_graph_evs);
+	SpanEdgeArr_clear(&o->vt.edges);
 	return !error;
 }
@@ -23,6 +23,9 @@
 enum {
 	ON_VISITED = 1<<0,
 	ON_TIME_INF = 1<<1, /* used for SAU_TIMEP_LINKED */
+	ON_SCHEDULED = 1<<2, /* has node in schedule being built */
+	ON_MULTIUSE = 1<<3, /* has several nodes in schedule being built */
+	ON_FREQ_RATIO = 1<<4, /* frequency relative to parent's, if ever */
 };
 
 typedef struct OperatorNode {
@@ -30,6 +33,7 @@ typedef struct OperatorNode {
 	uint32_t time;
 	uint32_t silence;
 	uint8_t flags;
+	uint32_t sched_node; /* first node, while ON_SCHEDULED */
 	const SAU_ProgramOpList *fmods;
 	const SAU_ProgramOpList *pmods;
 	const SAU_ProgramOpList *amods;
@@ -44,14 +48,73 @@ typedef struct OperatorNode {
  */
 enum {
 	VN_INIT = 1<<0,
+	VN_ACTIVE = 1<<1, /* in list of voices playing */
 };
 
+/*
+ * Run schedule node, for each use of an operator in a voice graph,
+ * in the order reached from the carriers (modulators after users).
+ * Holds the buffers to use, numbered from the first of the voice.
+ * Buffers are only allotted for the steps which use them, and are
+ * re-used by later nodes once no longer needed.
+ *
+ * A modulator used by several operators is run once per block if
+ * possible, its first node then keeping the output in its own \a out
+ * buffer and the parent frequency it ran for in \a key, and later
+ * nodes for it copying the output (skipping its modulators).
+ *
+ * The modulator lists marked in \a par_uses hold subtrees large
+ * enough to be worth running in parallel, sharing no operators.
+ */
+typedef struct RunNode {
+	uint32_t op_id;
+	uint32_t parent;  /* node index, or RUN_NO_PARENT for carriers */
+	uint32_t end;     /* index of step following those for node */
+	uint32_t list_ind; /* index in modulator list or carriers */
+	uint32_t first;   /* node for first use of operator */
+	uint8_t use;
+	uint8_t level;
+	bool circular;    /* already used above; output zero instead */
+	uint16_t s_buf, freq, freq2, fm, pm, amp, amp2, am;
+	uint16_t out, key; /* zero unless first use of shared modulator */
+	uint8_t par_uses; /* modulator lists to run as tasks, 1<<use */
+} RunNode;
+
+#define RUN_NO_PARENT UINT32_MAX
+
+/*
+ * Run schedule step types. Each node has a step of each type in the
+ * order listed, with those for modulators in between, except that a
+ * circular node only has RUN_BEGIN.
+ */
+enum {
+	RUN_BEGIN = 0, /* silence, length, and ramps for FM */
+	RUN_FREQ,      /* frequency, after any FM modulators */
+	RUN_AMP,       /* amplitude, after any PM modulators */
+	RUN_OSC,       /* oscillator, after any AM modulators */
+};
+
+typedef struct RunStep {
+	uint32_t node : 30;
+	uint32_t type : 2;
+} RunStep;
+
+/*
+ * Flattened voice graph, run without recursion.
+ */
+typedef struct RunSchedule {
+	const RunNode *nodes;
+	const RunStep *steps;
+	uint32_t node_count;
+	uint32_t step_count;
+} RunSchedule;
+
 typedef struct VoiceNode {
-	int32_t pos; /* negative for wait time */
 	uint32_t duration;
 	uint8_t flags;
 	const SAU_ProgramOpRef *graph;
 	uint32_t graph_count;
+	RunSchedule sched;
 	SAU_Ramp pan;
 	uint32_t pan_pos;
 } VoiceNode;
@@ -60,20 +123,43 @@ typedef struct EventNode {
 	uint32_t wait;
 	uint32_t graph_count;
 	const SAU_ProgramOpRef *graph;
+	RunSchedule sched;
 	const SAU_ProgramEvent *prg_e;
 } EventNode;
 
 sauArrType(SAU_OpRefArr, SAU_ProgramOpRef, )
+sauArrType(RunNodeArr, RunNode, )
+sauArrType(RunStepArr, RunStep, )
+sauArrType(BufSlotArr, uint16_t, )
+sauArrType(NodeCountArr, uint32_t, )
+sauArrType(SpanEdgeArr, uint64_t, )
 
 /*
  * Voice data per event during pre-allocation pass.
  */
 typedef struct SAU_VoiceGraph {
 	SAU_OpRefArr vo_graph;
+	RunNodeArr sched_nodes;
+	RunStepArr sched_steps;
+	BufSlotArr free_bufs; // freed and available for re-use
+	uint16_t buf_count;   // allotted for current traversal
+	NodeCountArr subtree_sizes; // for marking lists to run as tasks
 	uint32_t nest_level;
 	uint32_t nest_max; // for all traversals
 } SAU_VoiceGraph;
 
+/*
+ * Voice timing during pre-allocation pass, for finding
+ * the peak number of voices playing at once.
+ */
+typedef struct SAU_VoiceTiming {
+	uint64_t pos;
+	uint64_t *op_ends; // per operator, position its time ends
+	uint64_t *vo_starts, *vo_ends; // per voice, of span playing
+	const EventNode **vo_graph_evs; // per voice, giving graph
+	SpanEdgeArr edges; // start and end of each span, for counting
+} SAU_VoiceTiming;
+
 /*
  * Pre-allocation data. For copying from after filled.
  */
@@ -83,12 +169,16 @@ typedef struct SAU_PreAlloc {
 	size_t ev_count;
 	uint32_t op_count;
 	uint16_t vo_count;
-	uint16_t max_bufs;
+	uint16_t max_bufs; // peak number of buffers live at once
+	uint32_t max_nodes; // for any voice schedule
+	uint32_t max_tasks; // most subtrees in a list run as tasks
+	uint16_t max_active; // peak number of voices playing at once
 	EventNode **events;
 	VoiceNode *voices;
 	OperatorNode *operators;
 	SAU_MemPool *mem;
 	SAU_VoiceGraph vg;
+	SAU_VoiceTiming vt;
 } SAU_PreAlloc;
 
 bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
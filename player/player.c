@@ -17,17 +17,49 @@
 #include "wavfile.h"
 #include "../time.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #define BUF_TIME_MS  256
 #define CH_MIN_LEN   1
 #define NUM_CHANNELS 2
 
+/*
+ * Checkpoint file header, followed by the interpreter state saved
+ * using SAU_Interp_save(). The script hash, sample rate and options
+ * must match for resuming, and the program is continued after the
+ * audio data for the WAV file up until the checkpoint.
+ */
+typedef struct SAU_CheckpointHead {
+	char magic[8];
+	uint64_t hash;
+	uint32_t srate;
+	uint32_t interp_flags;
+	uint32_t prg_index;
+	uint32_t wav_samples;
+} SAU_CheckpointHead;
+
+#define CKPT_MAGIC "SAUCKPT1"
+
 typedef struct SAU_Output {
 	SAU_AudioDev *ad;
 	SAU_WAVFile *wf;
 	int16_t *buf;
 	uint32_t ad_srate;
+	uint32_t threads;
+	uint32_t segments;
 	uint32_t options;
+	uint32_t start_ms, end_ms; /* range to play, end_ms 0 if none */
+	size_t start_pos, end_pos; /* in samples, set for each run */
+	uint32_t ckpt_ms; /* checkpoint interval, 0 if none */
+	size_t ckpt_len, ckpt_next; /* in samples, set for each run */
+	char *ckpt_path, *ckpt_tmp_path;
+	SAU_CheckpointHead ckpt; /* for next checkpoint written */
+	FILE *resume; /* state to load for program ckpt.prg_index */
+	bool wav_incomplete; /* segment failed, leaving a gap */
 	size_t buf_len;
 	size_t ch_len;
 } SAU_Output;
@@ -37,28 +69,189 @@ typedef struct SAU_Output {
  */
 static bool SAU_fini_Output(SAU_Output *restrict o) {
 	free(o->buf);
+	free(o->ckpt_path);
+	free(o->ckpt_tmp_path);
+	if (o->resume != NULL) fclose(o->resume);
 	if (o->ad != NULL) SAU_close_AudioDev(o->ad);
 	if (o->wf != NULL)
 		return (SAU_close_WAVFile(o->wf) == 0);
 	return true;
 }
 
+/*
+ * Get interpreter flags for the options used.
+ */
+static uint32_t get_interp_flags(uint32_t options) {
+	uint32_t interp_flags = 0;
+	if ((options & SAU_ARG_POLYBLEP) != 0)
+		interp_flags |= SAU_INTERP_POLYBLEP;
+	if ((options & SAU_ARG_CTL_RAMPS) != 0)
+		interp_flags |= SAU_INTERP_CTL_RAMPS;
+	return interp_flags;
+}
+
+/*
+ * Allocate string for \p path with \p suffix appended.
+ *
+ * \return string, or NULL on allocation failure
+ */
+static char *add_suffix(const char *restrict path,
+		const char *restrict suffix) {
+	size_t path_len = strlen(path), suffix_len = strlen(suffix);
+	char *str = malloc(path_len + suffix_len + 1);
+	if (!str)
+		return NULL;
+	memcpy(str, path, path_len);
+	memcpy(str + path_len, suffix, suffix_len + 1);
+	return str;
+}
+
+/*
+ * Set up writing checkpoints every \p ckpt_ms for the WAV file,
+ * to a file named after it with ".ckpt" added. If the checkpoint
+ * file exists, it is opened for resuming, after checking that it
+ * matches the scripts and options; \p hash covers the scripts.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_init_checkpoints(SAU_Output *restrict o,
+		uint32_t ckpt_ms, const char *restrict wav_path,
+		uint64_t hash, uint32_t srate) {
+	o->ckpt_ms = ckpt_ms;
+	o->ckpt_path = add_suffix(wav_path, ".ckpt");
+	o->ckpt_tmp_path = add_suffix(wav_path, ".ckpt.tmp");
+	if (!o->ckpt_path || !o->ckpt_tmp_path)
+		return false;
+	SAU_CheckpointHead *head = &o->ckpt;
+	memset(head, 0, sizeof(*head)); /* no unset padding written */
+	memcpy(head->magic, CKPT_MAGIC, sizeof(head->magic));
+	head->hash = hash;
+	head->srate = srate;
+	head->interp_flags = get_interp_flags(o->options);
+	FILE *f = fopen(o->ckpt_path, "rb");
+	if (!f)
+		return true; /* nothing to resume */
+	SAU_CheckpointHead saved;
+	if (fread(&saved, sizeof(saved), 1, f) != 1 ||
+			memcmp(saved.magic, head->magic,
+				sizeof(head->magic)) != 0 ||
+			saved.hash != head->hash ||
+			saved.srate != head->srate ||
+			saved.interp_flags != head->interp_flags) {
+		SAU_error(NULL,
+"checkpoint \"%s\" does not match scripts and options; remove to start over",
+			o->ckpt_path);
+		fclose(f);
+		return false;
+	}
+	head->prg_index = saved.prg_index;
+	head->wav_samples = saved.wav_samples;
+	o->resume = f;
+	return true;
+}
+
+/*
+ * Write checkpoint for the state of \p gen, after flushing the
+ * WAV file. Writes a temporary file, then renames it, so that
+ * the previous checkpoint remains if interrupted.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_checkpoint(SAU_Output *restrict o,
+		const SAU_Interp *restrict gen) {
+	if (!SAU_WAVFile_sync(o->wf))
+		return false;
+	FILE *f = fopen(o->ckpt_tmp_path, "wb");
+	if (!f)
+		return false;
+	o->ckpt.wav_samples = SAU_WAVFile_samples(o->wf);
+	bool ok = (fwrite(&o->ckpt, sizeof(o->ckpt), 1, f) == 1) &&
+		SAU_Interp_save(gen, f);
+	ok = (fclose(f) == 0) && ok;
+	return ok && (rename(o->ckpt_tmp_path, o->ckpt_path) == 0);
+}
+
+/*
+ * Get the largest number of threads to run at once, the number
+ * of CPUs online, if known, and no more than the interpreter allows.
+ */
+static uint32_t get_max_threads(void) {
+	uint32_t max = SAU_INTERP_THREADS_MAX;
+#ifdef _SC_NPROCESSORS_ONLN
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus > 0 && (unsigned long) cpus < max)
+		max = cpus;
+#endif
+	return max;
+}
+
+/*
+ * Limit the number of threads used to run voices to the number
+ * of CPUs online, if known, and to what the interpreter allows.
+ *
+ * \return number of threads to use
+ */
+static uint32_t cap_threads(uint32_t threads) {
+	uint32_t max = get_max_threads();
+	if (threads > max) {
+		threads = max;
+		SAU_warning(NULL, "using %u threads, one per CPU", threads);
+	}
+	return threads;
+}
+
+/*
+ * Limit the number of time segments rendered at once, each using
+ * \p threads threads, so that all threads are no more than for
+ * cap_threads(). Each segment also keeps an interpreter and a
+ * temporary file open, and skips ahead from the beginning.
+ *
+ * \return number of segments to use
+ */
+static uint32_t cap_segments(uint32_t segments, uint32_t threads) {
+	uint32_t max = get_max_threads() / threads;
+	if (max < 1)
+		max = 1;
+	if (segments > max) {
+		segments = max;
+		SAU_warning(NULL,
+"using %u time segments of %u threads, one thread per CPU",
+				segments, threads);
+	}
+	return segments;
+}
+
 /*
  * Set up use of audio device and/or WAV file, and buffer of suitable size.
+ * With checkpoints every \p ckpt_ms, the WAV file is continued if there
+ * is a checkpoint to resume from.
  *
  * \return true unless error occurred
  */
 static bool SAU_init_Output(SAU_Output *restrict o, uint32_t srate,
-		uint32_t options, const char *restrict wav_path) {
+		uint32_t threads, uint32_t segments,
+		uint32_t start_ms, uint32_t end_ms, uint32_t options,
+		const char *restrict wav_path,
+		uint32_t ckpt_ms, uint64_t hash) {
 	bool use_audiodev = (wav_path != NULL) ?
 		((options & SAU_ARG_AUDIO_ENABLE) != 0) :
 		((options & SAU_ARG_AUDIO_DISABLE) == 0);
 	uint32_t ad_srate = srate;
 	uint32_t max_srate = srate;
 	*o = (SAU_Output){0};
+	o->threads = cap_threads(threads);
+	o->segments = cap_segments(segments, o->threads);
+	o->start_ms = start_ms;
+	o->end_ms = end_ms;
 	o->options = options;
 	if ((options & SAU_ARG_MODE_CHECK) != 0)
 		return true;
+	if (ckpt_ms > 0 && wav_path != NULL &&
+			!SAU_Output_init_checkpoints(o, ckpt_ms, wav_path,
+				hash, srate)) {
+		SAU_fini_Output(o);
+		return false;
+	}
 	if (use_audiodev) {
 		o->ad = SAU_open_AudioDev(NUM_CHANNELS, &ad_srate);
 		if (!o->ad) goto ERROR;
@@ -75,7 +268,10 @@ static bool SAU_init_Output(SAU_Output *restrict o, uint32_t srate,
 	o->buf = calloc(o->buf_len, sizeof(int16_t));
 	if (!o->buf) goto ERROR;
 	if (wav_path != NULL) {
-		o->wf = SAU_create_WAVFile(wav_path, NUM_CHANNELS, srate);
+		o->wf = (o->resume != NULL) ?
+			SAU_reopen_WAVFile(wav_path, NUM_CHANNELS, srate,
+					o->ckpt.wav_samples) :
+			SAU_create_WAVFile(wav_path, NUM_CHANNELS, srate);
 		if (!o->wf) goto ERROR;
 	}
 	return true;
@@ -83,6 +279,247 @@ ERROR:
 	return SAU_fini_Output(o);
 }
 
+/*
+ * Set the range of samples to play at \p srate, from the range
+ * of time, if any.
+ */
+static void SAU_Output_set_range(SAU_Output *restrict o, uint32_t srate) {
+	o->start_pos = SAU_MS_IN_SAMPLES(o->start_ms, srate);
+	o->end_pos = (o->end_ms > 0) ?
+		SAU_MS_IN_SAMPLES(o->end_ms, srate) :
+		SIZE_MAX;
+}
+
+/*
+ * Send \p len samples from the buffer, generated from sample
+ * position \p pos, to the audio device and/or WAV file. Only
+ * the part within the range to play is sent.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_write(SAU_Output *restrict o,
+		size_t pos, size_t len,
+		bool use_audiodev, bool use_wavfile) {
+	int16_t *buf = o->buf;
+	bool error = false;
+	if (pos + len > o->end_pos)
+		len = (o->end_pos > pos) ? o->end_pos - pos : 0;
+	if (pos < o->start_pos) {
+		size_t skip_len = o->start_pos - pos;
+		if (skip_len >= len)
+			return true;
+		buf += skip_len * NUM_CHANNELS;
+		len -= skip_len;
+	}
+	if (!len)
+		return true;
+	if (use_audiodev && !SAU_AudioDev_write(o->ad, buf, len)) {
+		error = true;
+		SAU_error(NULL, "audio device write failed");
+	}
+	if (use_wavfile && !SAU_WAVFile_write(o->wf, buf, len)) {
+		error = true;
+		SAU_error(NULL, "WAV file write failed");
+	}
+	return !error;
+}
+
+/*
+ * Run \p gen in runs of ch_len samples, sending the output in the
+ * range to play to the audio device and/or WAV file. Skips ahead
+ * to the run which includes the start of the range, so that the
+ * output is the same as when running from the beginning; or if
+ * resumed, continues from there.
+ *
+ * Writes checkpoints along with the WAV file output, if enabled.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_run_gen(SAU_Output *restrict o,
+		SAU_Interp *restrict gen,
+		bool use_audiodev, bool use_wavfile) {
+	size_t pos = o->start_pos - (o->start_pos % o->ch_len);
+	bool error = false;
+	size_t at = SAU_Interp_seek(gen, pos, o->ch_len);
+	if (at < pos)
+		return true;
+	pos = at;
+	bool use_ckpt = use_wavfile && (o->ckpt_ms > 0);
+	o->ckpt_next = pos + o->ckpt_len;
+	while (pos < o->end_pos) {
+		size_t len = SAU_Interp_run(gen, o->buf, o->ch_len);
+		if (!len) break;
+		if (!SAU_Output_write(o, pos, len,
+					use_audiodev, use_wavfile))
+			error = true;
+		pos += len;
+		if (use_ckpt && !error && pos >= o->ckpt_next) {
+			if (!SAU_Output_checkpoint(o, gen)) {
+				error = true;
+				SAU_error(NULL,
+"failed to write checkpoint \"%s\"", o->ckpt_path);
+			}
+			o->ckpt_next = pos + o->ckpt_len;
+		}
+	}
+	return !error;
+}
+
+/*
+ * Time segment of a program, rendered by a thread of its own
+ * into a temporary file.
+ */
+typedef struct SAU_Segment {
+	const SAU_Program *prg;
+	const SAU_Output *out;
+	uint32_t srate;
+	uint32_t interp_flags;
+	size_t first, count; /* in runs of ch_len samples */
+	FILE *f;
+	pthread_t thread;
+	bool started;
+	const char *error; /* what failed, if anything */
+	int errnum; /* errno value for error, or 0 */
+} SAU_Segment;
+
+/*
+ * Segment thread main function. Skips ahead to the first run
+ * of the segment, making the same calls as when running up to
+ * it, then runs and writes the output for the segment.
+ */
+static void *run_segment(void *arg) {
+	SAU_Segment *seg = arg;
+	const SAU_Output *out = seg->out;
+	int16_t *buf = calloc(out->buf_len, sizeof(int16_t));
+	SAU_Interp *gen = SAU_create_Interp(seg->prg, seg->srate,
+			seg->interp_flags, out->threads);
+	if (!buf || !gen) {
+		seg->error = "failed to allocate buffer or interpreter";
+		goto DONE;
+	}
+	seg->f = tmpfile();
+	if (!seg->f) {
+		seg->error = "failed to create temporary file";
+		seg->errnum = errno;
+		goto DONE;
+	}
+	size_t pos = seg->first * out->ch_len;
+	if (SAU_Interp_seek(gen, pos, out->ch_len) < pos)
+		goto DONE;
+	for (size_t i = 0; i < seg->count; ++i) {
+		size_t len = SAU_Interp_run(gen, buf, out->ch_len);
+		if (!len) break;
+		if (fwrite(buf, NUM_CHANNELS * sizeof(int16_t), len,
+				seg->f) != len) {
+			seg->error = "failed to write temporary file";
+			seg->errnum = errno;
+			break;
+		}
+	}
+DONE:
+	SAU_destroy_Interp(gen);
+	free(buf);
+	return NULL;
+}
+
+/*
+ * Copy output of segment from temporary file \p f to the WAV file,
+ * the output generated from sample position \p pos.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_write_segment(SAU_Output *restrict o,
+		FILE *restrict f, size_t pos) {
+	size_t len;
+	rewind(f);
+	while ((len = fread(o->buf, NUM_CHANNELS * sizeof(int16_t),
+				o->ch_len, f)) > 0) {
+		if (!SAU_Output_write(o, pos, len, false, true))
+			return false;
+		pos += len;
+	}
+	return !ferror(f);
+}
+
+/*
+ * Produce audio for program \p prg at \p srate for the WAV file,
+ * split into time segments rendered in parallel by threads, then
+ * written in order. The segments split the runs in the range to
+ * play, or up to the duration of the program, the last one then
+ * also running until the signal ends.
+ *
+ * There are no more segments than runs, and if a thread cannot
+ * be created, the segment is rendered by the calling thread.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_run_segments(SAU_Output *restrict o,
+		const SAU_Program *restrict prg,
+		uint32_t srate, uint32_t interp_flags) {
+	size_t first = o->start_pos / o->ch_len;
+	size_t end = (o->end_pos < SIZE_MAX) ?
+		o->end_pos :
+		SAU_MS_IN_SAMPLES(prg->duration_ms, srate);
+	end = (end + o->ch_len - 1) / o->ch_len;
+	size_t runs = (end > first) ? end - first : 0;
+	uint32_t count = o->segments;
+	if (count > runs) {
+		count = (runs > 0) ? runs : 1;
+		SAU_warning(NULL,
+"using %u time segments, one per %u ms of output", count, BUF_TIME_MS);
+	}
+	SAU_Segment *segs = calloc(count, sizeof(SAU_Segment));
+	if (!segs)
+		return false;
+	bool in_main = false;
+	uint32_t i;
+	for (i = 0; i < count; ++i) {
+		SAU_Segment *seg = &segs[i];
+		seg->prg = prg;
+		seg->out = o;
+		seg->srate = srate;
+		seg->interp_flags = interp_flags;
+		seg->first = first + runs * i / count;
+		seg->count = first + runs * (i + 1) / count - seg->first;
+		if (i == count - 1 && o->end_pos == SIZE_MAX)
+			seg->count = SIZE_MAX;
+		if (pthread_create(&seg->thread, NULL,
+					run_segment, seg) != 0) {
+			if (!in_main)
+				SAU_warning(NULL,
+"failed to create thread, rendering segments in main thread");
+			in_main = true;
+			run_segment(seg);
+			continue;
+		}
+		seg->started = true;
+	}
+	bool error = false;
+	for (i = 0; i < count; ++i) {
+		SAU_Segment *seg = &segs[i];
+		if (seg->started)
+			pthread_join(seg->thread, NULL);
+		if (!error && seg->error != NULL) {
+			error = true;
+			if (seg->errnum != 0)
+				SAU_error(NULL, "time segment %u: %s: %s",
+						i + 1, seg->error,
+						strerror(seg->errnum));
+			else
+				SAU_error(NULL, "time segment %u: %s",
+						i + 1, seg->error);
+		}
+		if (!error && !SAU_Output_write_segment(o, seg->f,
+					seg->first * o->ch_len)) {
+			error = true;
+			SAU_error(NULL, "WAV file write failed");
+		}
+		if (seg->f != NULL) fclose(seg->f);
+	}
+	free(segs);
+	return !error;
+}
+
 /*
  * Produce audio for program \p prg, optionally sending it
  * to the audio device and/or WAV file.
@@ -93,41 +530,49 @@ static bool SAU_Output_run(SAU_Output *restrict o,
 		const SAU_Program *restrict prg,
 		bool split_gen, uint32_t other_srate) {
 	uint32_t srate = (o->ad != NULL) ? o->ad_srate : other_srate;
-	SAU_Interp *gen = SAU_create_Interp(prg, srate);
+	uint32_t interp_flags = get_interp_flags(o->options);
+	SAU_Interp *gen = SAU_create_Interp(prg, srate, interp_flags,
+			o->threads);
 	if (!gen)
 		return false;
-	size_t len;
+	if (o->resume != NULL) {
+		bool loaded = SAU_Interp_load(gen, o->resume);
+		fclose(o->resume);
+		o->resume = NULL;
+		if (!loaded) {
+			SAU_error(NULL, "failed to load checkpoint \"%s\"",
+				o->ckpt_path);
+			SAU_destroy_Interp(gen);
+			return false;
+		}
+	}
 	bool error = false;
 	bool run = !(o->options & SAU_ARG_MODE_CHECK);
 	if ((o->options & SAU_ARG_PRINT_INFO) != 0)
 		SAU_Interp_print(gen);
 	if (run && split_gen && (o->ad != NULL)) {
-		for (;;) {
-			len = SAU_Interp_run(gen, o->buf, o->ch_len);
-			if (!len) break;
-			if (!SAU_AudioDev_write(o->ad, o->buf, len)) {
-				error = true;
-				SAU_error(NULL, "audio device write failed");
-			}
-		}
+		SAU_Output_set_range(o, srate);
+		if (!SAU_Output_run_gen(o, gen, true, false))
+			error = true;
 		SAU_destroy_Interp(gen);
-		gen = SAU_create_Interp(prg, other_srate);
+		gen = SAU_create_Interp(prg, other_srate, interp_flags,
+				o->threads);
 		if (!gen)
 			return false;
 	}
 	bool use_audiodev = !split_gen && (o->ad != NULL);
 	bool use_wavfile = (o->wf != NULL);
-	if (run) for (;;) {
-		len = SAU_Interp_run(gen, o->buf, o->ch_len);
-		if (!len) break;
-		if (use_audiodev && !SAU_AudioDev_write(o->ad, o->buf, len)) {
+	SAU_Output_set_range(o, other_srate);
+	o->ckpt_len = SAU_MS_IN_SAMPLES(o->ckpt_ms, other_srate);
+	if (run && !use_audiodev && use_wavfile && o->segments > 1) {
+		if (!SAU_Output_run_segments(o, prg, other_srate,
+					interp_flags)) {
+			o->wav_incomplete = true;
 			error = true;
-			SAU_error(NULL, "audio device write failed");
 		}
-		if (use_wavfile && !SAU_WAVFile_write(o->wf, o->buf, len)) {
+	} else if (run) {
+		if (!SAU_Output_run_gen(o, gen, use_audiodev, use_wavfile))
 			error = true;
-			SAU_error(NULL, "WAV file write failed");
-		}
 	}
 	SAU_destroy_Interp(gen);
 	return !error;
@@ -135,7 +580,17 @@ static bool SAU_Output_run(SAU_Output *restrict o,
 
 /**
  * Run the listed programs through the audio generator until completion,
- * ignoring NULL entries.
+ * ignoring NULL entries. Voices are run using \p threads threads.
+ * Output only for a WAV file is rendered using \p segments time
+ * segments in parallel, if more than one.
+ *
+ * Only the output from \p start_ms until \p end_ms is played, or
+ * until the end if \p end_ms is 0; skipping ahead to the start.
+ *
+ * If \p ckpt_ms is not 0, a checkpoint is written every \p ckpt_ms
+ * of output for the WAV file, and a checkpoint left by an earlier
+ * run for the same scripts and options is resumed from. It is
+ * removed once done.
  *
  * The output is sent to either none, one, or both of the audio device
  * or a WAV file.
@@ -143,12 +598,26 @@ static bool SAU_Output_run(SAU_Output *restrict o,
  * \return true unless error occurred
  */
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
+		uint32_t threads, uint32_t segments,
+		uint32_t start_ms, uint32_t end_ms, uint32_t ckpt_ms,
 		uint32_t options, const char *restrict wav_path) {
 	if (!prg_objs->count)
 		return true;
 
+	const SAU_Program **prgs =
+		(const SAU_Program**) SAU_PtrArr_ITEMS(prg_objs);
+	uint64_t hash = SAU_FNV_OFFSET; /* FNV-1a of script hashes */
+	for (size_t i = 0; i < prg_objs->count; ++i) {
+		uint64_t prg_hash = (prgs[i] != NULL) ?
+			prgs[i]->script_hash : 0;
+		for (int j = 0; j < 64; j += 8)
+			hash = (hash ^ ((prg_hash >> j) & 0xff)) *
+				SAU_FNV_PRIME;
+	}
 	SAU_Output out;
-	if (!SAU_init_Output(&out, srate, options, wav_path))
+	if (!SAU_init_Output(&out, srate, threads, segments,
+				start_ms, end_ms, options, wav_path,
+				ckpt_ms, hash))
 		return false;
 	bool status = true;
 	bool split_gen = false;
@@ -157,15 +626,24 @@ bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
 		SAU_warning(NULL,
 "generating audio twice, using different sample rates");
 	}
-	const SAU_Program **prgs =
-		(const SAU_Program**) SAU_PtrArr_ITEMS(prg_objs);
-	for (size_t i = 0; i < prg_objs->count; ++i) {
+	size_t first = (out.resume != NULL) ? out.ckpt.prg_index : 0;
+	for (size_t i = first; i < prg_objs->count; ++i) {
 		const SAU_Program *prg = prgs[i];
 		if (!prg) continue;
+		out.ckpt.prg_index = i;
 		if (!SAU_Output_run(&out, prg, split_gen, srate))
 			status = false;
 	}
+	char *ckpt_path = out.ckpt_path;
+	out.ckpt_path = NULL;
+	bool wav_incomplete = out.wav_incomplete;
 	if (!SAU_fini_Output(&out))
 		status = false;
+	if (wav_incomplete && remove(wav_path) == 0)
+		SAU_error(NULL, "removed incomplete WAV file \"%s\"",
+			wav_path);
+	if (status && ckpt_path != NULL)
+		remove(ckpt_path);
+	free(ckpt_path);
 	return status;
 }
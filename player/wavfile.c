@@ -39,7 +39,29 @@ static void fputl(uint32_t i32, FILE *restrict stream) {
 	putc(b, stream);
 }
 
+static uint16_t fgetw(FILE *restrict stream) {
+	uint16_t i16;
+	i16 = getc(stream) & 0xff;
+	i16 |= (getc(stream) & 0xff) << 8;
+	return i16;
+}
+
+static uint32_t fgetl(FILE *restrict stream) {
+	uint32_t i32;
+	i32 = fgetw(stream);
+	i32 |= (uint32_t) fgetw(stream) << 16;
+	return i32;
+}
+
+static bool fcheck(const char *restrict str, FILE *restrict stream) {
+	for (; *str != '\0'; ++str)
+		if (getc(stream) != *str)
+			return false;
+	return true;
+}
+
 #define SOUND_BITS 16
+#define HEADER_SIZE 44
 #define SOUND_BYTES (SOUND_BITS / 8)
 
 struct SAU_WAVFile {
@@ -86,6 +108,49 @@ SAU_WAVFile *SAU_create_WAVFile(const char *restrict fpath,
 	return o;
 }
 
+/**
+ * Open an existing 16-bit WAV file, as written by SAU_create_WAVFile()
+ * with the same \p channels and \p srate, to continue writing after
+ * the first \p samples. Any audio data after them is written over.
+ *
+ * \return instance or NULL if fopen fails or the file does not match
+ */
+SAU_WAVFile *SAU_reopen_WAVFile(const char *restrict fpath,
+		uint16_t channels, uint32_t srate, uint32_t samples) {
+	FILE *f = fopen(fpath, "r+b");
+	if (!f) {
+		SAU_error(NULL, "couldn't open WAV file \"%s\" for appending",
+			fpath);
+		return NULL;
+	}
+	uint32_t block = channels * SOUND_BYTES;
+	bool ok = fcheck("RIFF", f);
+	fgetl(f);
+	ok = ok && fcheck("WAVE", f) && fcheck("fmt ", f);
+	ok = ok && (fgetl(f) == 16) && (fgetw(f) == 1) &&
+		(fgetw(f) == channels) && (fgetl(f) == srate);
+	ok = ok && (fgetl(f) == block * srate) && (fgetw(f) == block) &&
+		(fgetw(f) == SOUND_BITS) && fcheck("data", f);
+	if (ok && fseek(f, 0, SEEK_END) == 0) {
+		long size = ftell(f);
+		ok = (size >= 0 &&
+			(uint64_t) size >= HEADER_SIZE +
+			(uint64_t) samples * block);
+	}
+	if (!ok || fseek(f, HEADER_SIZE + (long) samples * block,
+				SEEK_SET) != 0) {
+		SAU_error(NULL, "WAV file \"%s\" does not match output",
+			fpath);
+		fclose(f);
+		return NULL;
+	}
+	SAU_WAVFile *o = malloc(sizeof(SAU_WAVFile));
+	o->f = f;
+	o->channels = channels;
+	o->samples = samples;
+	return o;
+}
+
 /**
  * Write \p samples from \p buf to WAV file. Channels are assumed
  * to be interleaved in the buffer, and the buffer of length
@@ -101,6 +166,44 @@ bool SAU_WAVFile_write(SAU_WAVFile *restrict o,
 	return (written == samples);
 }
 
+/*
+ * Write the total length/size of audio data written to the header,
+ * leaving the file position after the header.
+ */
+static void update_header(SAU_WAVFile *restrict o) {
+	FILE *f = o->f;
+	uint32_t bytes = o->channels * o->samples * SOUND_BYTES;
+
+	fseek(f, 4 /* after "RIFF" */, SEEK_SET);
+	fputl(36 + bytes, f);
+
+	fseek(f, 32 /* after "data" */, SEEK_CUR);
+	fputl(bytes, f); /* fmt-chunk size */
+}
+
+/**
+ * Update the WAV file header with the audio data written so far,
+ * and flush the file, so that it is complete up to this point.
+ * Writing then continues after that data.
+ *
+ * \return true unless error occurred
+ */
+bool SAU_WAVFile_sync(SAU_WAVFile *restrict o) {
+	FILE *f = o->f;
+	update_header(o);
+	fseek(f, HEADER_SIZE + (long) o->samples *
+			o->channels * SOUND_BYTES, SEEK_SET);
+	return (fflush(f) == 0) && !ferror(f);
+}
+
+/**
+ * Get the number of samples written, counting any from before
+ * SAU_reopen_WAVFile().
+ */
+uint32_t SAU_WAVFile_samples(const SAU_WAVFile *restrict o) {
+	return o->samples;
+}
+
 /**
  * Close file and destroy instance.
  *
@@ -112,13 +215,7 @@ bool SAU_WAVFile_write(SAU_WAVFile *restrict o,
 int SAU_close_WAVFile(SAU_WAVFile *restrict o) {
 	int err;
 	FILE *f = o->f;
-	uint32_t bytes = o->channels * o->samples * SOUND_BYTES;
-
-	fseek(f, 4 /* after "RIFF" */, SEEK_SET);
-	fputl(36 + bytes, f);
-
-	fseek(f, 32 /* after "data" */, SEEK_CUR);
-	fputl(bytes, f); /* fmt-chunk size */
+	update_header(o);
 
 	err = ferror(f);
 	fclose(f);
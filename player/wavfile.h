@@ -23,7 +23,12 @@ typedef struct SAU_WAVFile SAU_WAVFile;
 
 SAU_WAVFile *SAU_create_WAVFile(const char *restrict fpath,
 		uint16_t channels, uint32_t srate) sauMalloclike;
+SAU_WAVFile *SAU_reopen_WAVFile(const char *restrict fpath,
+		uint16_t channels, uint32_t srate,
+		uint32_t samples) sauMalloclike;
 int SAU_close_WAVFile(SAU_WAVFile *restrict o);
 
 bool SAU_WAVFile_write(SAU_WAVFile *restrict o,
 		const int16_t *restrict buf, uint32_t samples);
+bool SAU_WAVFile_sync(SAU_WAVFile *restrict o);
+uint32_t SAU_WAVFile_samples(const SAU_WAVFile *restrict o);
@@ -113,6 +113,8 @@ typedef struct SAU_ProgramEvent {
  */
 enum {
 	SAU_PMODE_AMP_DIV_VOICES = 1<<0,
+	SAU_PMODE_CTL_RAMPS = 1<<1,
+	SAU_PMODE_CTL_RAMPS_SET = 1<<2, // CTL_RAMPS value given by script
 };
 
 struct SAU_MemPool;
@@ -128,6 +130,7 @@ typedef struct SAU_Program {
 	uint32_t op_count;
 	uint32_t duration_ms;
 	const char *name;
+	uint64_t script_hash; // of script text, if SAU_ARG_SCRIPT_HASH used
 	struct SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Program;
 
@@ -18,6 +18,7 @@
 #include "ramp.h"
 #include "math.h"
 #include "time.h"
+#include <pthread.h>
 // the noinline use below works around i386 clang performance issue
 
 const char *const SAU_Ramp_names[SAU_RAMP_TYPES + 1] = {
@@ -39,6 +40,235 @@ const SAU_Ramp_fill_f SAU_Ramp_fill_funcs[SAU_RAMP_TYPES] = {
 	SAU_Ramp_fill_lsd,
 };
 
+/*
+ * Get the 'lsd' curve value for \p x (0.0 to 1.0). Flipped around,
+ * 1.0 - x and the reverse direction, it's also the 'esd' curve.
+ */
+static sauAlwaysInline float sd_curve(float x) {
+	float xp2 = x * x,
+		xp3 = xp2 * x;
+	return xp3 + (xp2 * xp3 - xp2) *
+		(x * (629.f/1792.f) + xp2 * (1163.f/1792.f));
+}
+
+/*
+ * Plain C fill loop for the curve of ramp \p type (SAU_RAMP_LIN,
+ * SAU_RAMP_ESD or SAU_RAMP_LSD). Positions are counted as integers,
+ * each converted and scaled by \p inv_time to get the curve position.
+ *
+ * Multiplies with \p mulbuf values unless it's NULL; inlined with a
+ * NULL constant, the check disappears from the loop.
+ *
+ * \return number of values filled, always \p len
+ */
+static sauAlwaysInline uint32_t fill_c_body(float *restrict buf,
+		uint32_t len, float v0, float vt, uint32_t pos,
+		float inv_time, const float *restrict mulbuf, int type) {
+	for (uint32_t i = 0; i < len; ++i) {
+		const float x = (float) (pos + i) * inv_time;
+		float v;
+		if (type == SAU_RAMP_ESD)
+			v = vt + (v0 - vt) * sd_curve(1.f - x);
+		else if (type == SAU_RAMP_LSD)
+			v = v0 + (vt - v0) * sd_curve(x);
+		else
+			v = v0 + (vt - v0) * x;
+		buf[i] = (mulbuf != NULL) ? v * mulbuf[i] : v;
+	}
+	return len;
+}
+
+/*
+ * True if positions \p pos up to \p pos + \p len fit in signed 32-bit
+ * integers, which the SIMD loops convert them as. Past that, over
+ * 2^31 positions into a ramp, only the plain C loop is used.
+ */
+#define POS_FITS_INT32(pos, len) ((uint64_t) (pos) + (len) <= INT32_MAX)
+
+/*
+ * Define fill function named \p name for ramp \p type, using the
+ * \p body loop with function attributes \p attr. The plain C loop
+ * finishes what's left by \p body, if anything.
+ */
+#define DEF_FILL(name, attr, body, type) \
+static attr void name(float *restrict buf, uint32_t len, \
+		float v0, float vt, uint32_t pos, uint32_t time, \
+		const float *restrict mulbuf) { \
+	const float inv_time = 1.f / time; \
+	uint32_t i = 0; \
+	if (!mulbuf) { \
+		if (POS_FITS_INT32(pos, len)) \
+			i = body(buf, len, v0, vt, pos, inv_time, \
+					NULL, type); \
+		if (i < len) fill_c_body(buf + i, len - i, v0, vt, \
+				pos + i, inv_time, NULL, type); \
+	} else { \
+		if (POS_FITS_INT32(pos, len)) \
+			i = body(buf, len, v0, vt, pos, inv_time, \
+					mulbuf, type); \
+		if (i < len) fill_c_body(buf + i, len - i, v0, vt, \
+				pos + i, inv_time, mulbuf + i, type); \
+	} \
+}
+
+/*
+ * Define fill functions for the curves which use loops, named \p name
+ * suffixed with the curve name, and an array named \p name suffixed
+ * with "_fs" of them.
+ */
+#define DEF_FILL_CURVES(name, attr, body) \
+DEF_FILL(name##_lin, attr, body, SAU_RAMP_LIN) \
+DEF_FILL(name##_esd, attr, body, SAU_RAMP_ESD) \
+DEF_FILL(name##_lsd, attr, body, SAU_RAMP_LSD) \
+static const SAU_Ramp_fill_f name##_fs[SAU_RAMP_TYPES] = { \
+	[SAU_RAMP_LIN] = name##_lin, \
+	[SAU_RAMP_ESD] = name##_esd, \
+	[SAU_RAMP_LSD] = name##_lsd, \
+};
+
+DEF_FILL_CURVES(fill_c, , fill_c_body)
+
+static const SAU_Ramp_fill_f *fill_fs = fill_c_fs;
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__i386__) || defined(__x86_64__))
+# include "ramp/x86.c"
+# define INIT_ARCH() init_x86()
+#else
+# define INIT_ARCH() ((void)0)
+#endif
+
+static void init_arch(void) {
+	INIT_ARCH();
+}
+
+/**
+ * Select the fill loop versions to use,
+ * according to the features of the CPU.
+ *
+ * If already initialized, return without doing anything.
+ * Safe to call from several threads at once.
+ */
+void SAU_global_init_Ramp(void) {
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, init_arch);
+}
+
+/*
+ * Largest second derivative of the 'esd' and 'lsd' curves over
+ * the 0.0 to 1.0 range, at 1.0 for 'lsd', rounded up. Bounds the
+ * error of linear interpolation between points on the curve.
+ */
+#define SD_CURVE_MAX_D2 34.f
+
+/*
+ * Number of curve points computed together, for ramps
+ * filled at control rate.
+ */
+#define CTL_POINTS 16
+
+/*
+ * Offsets from the start of a segment between curve points,
+ * as floating point values, for ramps filled at control rate.
+ */
+static const float ctl_offs[SAU_Ramp_CTL_STEP] = {
+	0.f,  1.f,  2.f,  3.f,  4.f,  5.f,  6.f,  7.f,
+	8.f,  9.f,  10.f, 11.f, 12.f, 13.f, 14.f, 15.f,
+	16.f, 17.f, 18.f, 19.f, 20.f, 21.f, 22.f, 23.f,
+	24.f, 25.f, 26.f, 27.f, 28.f, 29.f, 30.f, 31.f,
+};
+
+/*
+ * Fill \p buf with \p len values of the curve of ramp \p type
+ * (SAU_RAMP_ESD or SAU_RAMP_LSD), computing a point every \p step
+ * (a power of two) positions, and interpolating linearly between
+ * them. The points are placed at multiples of \p step, so values
+ * don't depend on how a ramp is split up into runs.
+ */
+static sauAlwaysInline void fill_ctl(float *restrict buf, uint32_t len,
+		float v0, float vt, uint32_t pos, uint32_t time,
+		const float *restrict mulbuf, int type, uint32_t step) {
+	const float inv_time = 1.f / time;
+	const float inv_step = 1.f / step; /* exact for power of two */
+	uint32_t seg_pos = pos & ~(step - 1);
+	uint32_t i = 0;
+	while (i < len) {
+		/*
+		 * Get the next points, those past the end placed at it.
+		 */
+		float pts[CTL_POINTS + 1];
+		uint32_t segs = (pos + len - 1 - seg_pos) / step + 1;
+		if (segs > CTL_POINTS) segs = CTL_POINTS;
+		for (int32_t k = 0; k <= (int32_t) segs; ++k) {
+			uint32_t k_pos = seg_pos + k * step;
+			if (k_pos > time) k_pos = time;
+			fill_c_body(&pts[k], 1, v0, vt,
+					k_pos, inv_time, NULL, type);
+		}
+		for (uint32_t k = 0; k < segs; ++k) {
+			uint32_t i_pos = pos + i;
+			uint32_t seg_end = seg_pos + step;
+			const float a = pts[k];
+			const float inc = (seg_end <= time) ?
+				(pts[k + 1] - a) * inv_step :
+				(pts[k + 1] - a) / (float) (time - seg_pos);
+			uint32_t seg_len = seg_end - i_pos;
+			if (seg_len > len - i) seg_len = len - i;
+			const float *restrict offs = &ctl_offs[i_pos - seg_pos];
+			float *restrict seg_buf = &buf[i];
+			if (!mulbuf) {
+				for (uint32_t n = 0; n < seg_len; ++n)
+					seg_buf[n] = a + inc * offs[n];
+			} else {
+				const float *restrict seg_mulbuf = &mulbuf[i];
+				for (uint32_t n = 0; n < seg_len; ++n)
+					seg_buf[n] = (a + inc * offs[n]) *
+						seg_mulbuf[n];
+			}
+			i += seg_len;
+			seg_pos = seg_end;
+		}
+	}
+}
+
+/*
+ * Fill \p buf like the fill function for ramp \p type, but at
+ * control rate if the curve isn't linear and long enough for the
+ * error to stay within SAU_Ramp_CTL_MAX_ERROR.
+ *
+ * The step between points is the largest power of two, up to
+ * SAU_Ramp_CTL_STEP, for which the error bound of linear
+ * interpolation, (step / time)^2 * max. |f''| / 8 relative to
+ * the difference between \p v0 and \p vt, is small enough.
+ */
+static void fill_ctl_rate(float *restrict buf, uint32_t len,
+		float v0, float vt, uint32_t pos, uint32_t time,
+		const float *restrict mulbuf, uint8_t type) {
+	if (type == SAU_RAMP_EXP)
+		type = (v0 > vt) ? SAU_RAMP_ESD : SAU_RAMP_LSD;
+	else if (type == SAU_RAMP_LOG)
+		type = (v0 < vt) ? SAU_RAMP_ESD : SAU_RAMP_LSD;
+	if (type != SAU_RAMP_ESD && type != SAU_RAMP_LSD)
+		goto PER_SAMPLE;
+	const float max_step = time *
+		sqrtf(SAU_Ramp_CTL_MAX_ERROR * 8.f / SD_CURVE_MAX_D2);
+	uint32_t step = SAU_Ramp_CTL_STEP;
+	while (step > max_step) {
+		step >>= 1;
+		if (step < 4)
+			goto PER_SAMPLE;
+	}
+	if (type == SAU_RAMP_ESD)
+		fill_ctl(buf, len, v0, vt, pos, time, mulbuf,
+				SAU_RAMP_ESD, step);
+	else
+		fill_ctl(buf, len, v0, vt, pos, time, mulbuf,
+				SAU_RAMP_LSD, step);
+	return;
+PER_SAMPLE:
+	SAU_Ramp_fill_funcs[type](buf, len, v0, vt, pos, time, mulbuf);
+}
+
 /**
  * Fill \p buf with \p len values along a straight horizontal line,
  * i.e. \p len copies of \p v0.
@@ -66,15 +296,7 @@ sauNoinline void SAU_Ramp_fill_hold(float *restrict buf, uint32_t len,
 void SAU_Ramp_fill_lin(float *restrict buf, uint32_t len,
 		float v0, float vt, uint32_t pos, uint32_t time,
 		const float *restrict mulbuf) {
-	const float inv_time = 1.f / time;
-	for (uint32_t i = 0; i < len; ++i) {
-		const uint32_t i_pos = i + pos;
-		float v = v0 + (vt - v0) * (i_pos * inv_time);
-		if (!mulbuf)
-			buf[i] = v;
-		else
-			buf[i] = v * mulbuf[i];
-	}
+	fill_fs[SAU_RAMP_LIN](buf, len, v0, vt, pos, time, mulbuf);
 }
 
 /**
@@ -123,20 +345,7 @@ void SAU_Ramp_fill_log(float *restrict buf, uint32_t len,
 void SAU_Ramp_fill_esd(float *restrict buf, uint32_t len,
 		float v0, float vt, uint32_t pos, uint32_t time,
 		const float *restrict mulbuf) {
-	const float inv_time = 1.f / time;
-	for (uint32_t i = 0; i < len; ++i) {
-		const uint32_t i_pos = i + pos;
-		float mod = 1.f - i_pos * inv_time,
-			modp2 = mod * mod,
-			modp3 = modp2 * mod;
-		mod = modp3 + (modp2 * modp3 - modp2) *
-			(mod * (629.f/1792.f) + modp2 * (1163.f/1792.f));
-		float v = vt + (v0 - vt) * mod;
-		if (!mulbuf)
-			buf[i] = v;
-		else
-			buf[i] = v * mulbuf[i];
-	}
+	fill_fs[SAU_RAMP_ESD](buf, len, v0, vt, pos, time, mulbuf);
 }
 
 /**
@@ -151,20 +360,7 @@ void SAU_Ramp_fill_esd(float *restrict buf, uint32_t len,
 void SAU_Ramp_fill_lsd(float *restrict buf, uint32_t len,
 		float v0, float vt, uint32_t pos, uint32_t time,
 		const float *restrict mulbuf) {
-	const float inv_time = 1.f / time;
-	for (uint32_t i = 0; i < len; ++i) {
-		const uint32_t i_pos = i + pos;
-		float mod = i_pos * inv_time,
-			modp2 = mod * mod,
-			modp3 = modp2 * mod;
-		mod = modp3 + (modp2 * modp3 - modp2) *
-			(mod * (629.f/1792.f) + modp2 * (1163.f/1792.f));
-		float v = v0 + (vt - v0) * mod;
-		if (!mulbuf)
-			buf[i] = v;
-		else
-			buf[i] = v * mulbuf[i];
-	}
+	fill_fs[SAU_RAMP_LSD](buf, len, v0, vt, pos, time, mulbuf);
 }
 
 /**
@@ -180,9 +376,12 @@ void SAU_Ramp_reset(SAU_Ramp *restrict o) {
 /**
  * Copy changes from \p src to the instance,
  * preserving non-overridden parts of state.
+ *
+ * The goal time is converted to samples for \p srate,
+ * once here rather than for each run.
  */
 void SAU_Ramp_copy(SAU_Ramp *restrict o,
-		const SAU_Ramp *restrict src) {
+		const SAU_Ramp *restrict src, uint32_t srate) {
 	uint8_t mask = 0;
 	if ((src->flags & SAU_RAMPP_STATE) != 0) {
 		o->v0 = src->v0;
@@ -192,6 +391,7 @@ void SAU_Ramp_copy(SAU_Ramp *restrict o,
 	if ((src->flags & SAU_RAMPP_GOAL) != 0) {
 		o->vt = src->vt;
 		o->time_ms = src->time_ms;
+		o->time = SAU_MS_IN_SAMPLES(src->time_ms, srate);
 		o->type = src->type;
 		mask |= SAU_RAMPP_GOAL
 			| SAU_RAMPP_GOAL_RATIO
@@ -201,27 +401,14 @@ void SAU_Ramp_copy(SAU_Ramp *restrict o,
 	o->flags |= (src->flags & mask);
 }
 
-/**
- * Fill \p buf with \p buf_len values for the ramp.
- * A value is \a v0 if no goal is set, or a ramping
- * towards \a vt if a goal is set, unless converted
- * from a ratio.
- *
- * If state and/or goal is a ratio, \p mulbuf is
- * used for value multipliers, to get "absolute"
- * values. (If \p mulbuf is NULL, it is ignored,
- * with the same result as if given 1.0 values.)
- * Otherwise \p mulbuf is ignored.
- *
- * When a goal is reached and cleared, its \a vt value becomes
- * the new \a v0 value. This can be forced at any time, as the
- * \p pos can alternatively be NULL to skip all values before.
- *
- * \return true if ramp goal not yet reached
+/*
+ * Fill \p buf with \p buf_len values for the ramp,
+ * at control rate where possible if \p ctl_rate is true.
  */
-bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
-		float *restrict buf, uint32_t buf_len, uint32_t srate,
-		const float *restrict mulbuf) {
+static sauAlwaysInline bool run(SAU_Ramp *restrict o,
+		uint32_t *restrict pos,
+		float *restrict buf, uint32_t buf_len,
+		const float *restrict mulbuf, bool ctl_rate) {
 	uint32_t len = 0;
 	if (!(o->flags & SAU_RAMPP_GOAL)) goto FILL;
 	/*
@@ -242,11 +429,15 @@ bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
 		mulbuf = NULL; /* no ratio handling past first value */
 	}
 	if (!pos) goto REACHED;
-	uint32_t time = SAU_MS_IN_SAMPLES(o->time_ms, srate);
+	uint32_t time = o->time;
 	len = time - *pos;
 	if (len > buf_len) len = buf_len;
-	SAU_Ramp_fill_funcs[o->type](buf, len,
-			o->v0, o->vt, *pos, time, mulbuf);
+	if (ctl_rate)
+		fill_ctl_rate(buf, len,
+				o->v0, o->vt, *pos, time, mulbuf, o->type);
+	else
+		SAU_Ramp_fill_funcs[o->type](buf, len,
+				o->v0, o->vt, *pos, time, mulbuf);
 	*pos += len;
 	if (*pos == time)
 	REACHED: {
@@ -268,6 +459,44 @@ bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
 	return true;
 }
 
+/**
+ * Fill \p buf with \p buf_len values for the ramp.
+ * A value is \a v0 if no goal is set, or a ramping
+ * towards \a vt if a goal is set, unless converted
+ * from a ratio.
+ *
+ * If state and/or goal is a ratio, \p mulbuf is
+ * used for value multipliers, to get "absolute"
+ * values. (If \p mulbuf is NULL, it is ignored,
+ * with the same result as if given 1.0 values.)
+ * Otherwise \p mulbuf is ignored.
+ *
+ * When a goal is reached and cleared, its \a vt value becomes
+ * the new \a v0 value. This can be forced at any time, as the
+ * \p pos can alternatively be NULL to skip all values before.
+ *
+ * \return true if ramp goal not yet reached
+ */
+bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
+		float *restrict buf, uint32_t buf_len,
+		const float *restrict mulbuf) {
+	return run(o, pos, buf, buf_len, mulbuf, false);
+}
+
+/**
+ * Like SAU_Ramp_run(), but for curves other than linear, fill at
+ * control rate where possible. Curve points are then computed at
+ * most every SAU_Ramp_CTL_STEP values, with linear interpolation
+ * between them, keeping within SAU_Ramp_CTL_MAX_ERROR.
+ *
+ * \return true if ramp goal not yet reached
+ */
+bool SAU_Ramp_run_ctl(SAU_Ramp *restrict o, uint32_t *restrict pos,
+		float *restrict buf, uint32_t buf_len,
+		const float *restrict mulbuf) {
+	return run(o, pos, buf, buf_len, mulbuf, true);
+}
+
 /**
  * Skip ahead \p skip_len values for the ramp, updating state
  * and run position without generating values.
@@ -279,11 +508,11 @@ bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
  * \return true if ramp goal not yet reached
  */
 bool SAU_Ramp_skip(SAU_Ramp *restrict o, uint32_t *restrict pos,
-		uint32_t skip_len, uint32_t srate) {
+		uint32_t skip_len) {
 	if (!(o->flags & SAU_RAMPP_GOAL))
 		return false;
 	if (!pos) goto REACHED;
-	uint32_t time = SAU_MS_IN_SAMPLES(o->time_ms, srate);
+	uint32_t time = o->time;
 	uint32_t len = time - *pos;
 	if (len > skip_len) len = skip_len;
 	*pos += len;
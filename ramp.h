@@ -80,6 +80,7 @@ enum {
 typedef struct SAU_Ramp {
 	float v0, vt;
 	uint32_t time_ms;
+	uint32_t time; // in samples, set by SAU_Ramp_copy() for running
 	uint8_t type;
 	uint8_t flags;
 } SAU_Ramp;
@@ -93,12 +94,45 @@ typedef struct SAU_Ramp {
 #define SAU_Ramp_ENABLED(o) \
 	((o)->flags & (SAU_RAMPP_STATE | SAU_RAMPP_GOAL))
 
+/**
+ * Check whether the ramp only holds its state value, with no
+ * goal in progress. If so, its values are all the same unless
+ * a state ratio is multiplied with varying values.
+ *
+ * \return true if held
+ */
+#define SAU_Ramp_HELD(o) \
+	(!((o)->flags & SAU_RAMPP_GOAL))
+
+/**
+ * Largest number of values between curve points computed,
+ * for ramps filled at control rate.
+ */
+#define SAU_Ramp_CTL_STEP 32
+
+/**
+ * Largest error for ramps filled at control rate, relative to
+ * the difference between start and goal values. Shorter ramps
+ * use a smaller step, or are filled per value.
+ */
+#define SAU_Ramp_CTL_MAX_ERROR 1e-5f
+
+typedef bool (*SAU_Ramp_run_f)(SAU_Ramp *restrict o,
+		uint32_t *restrict pos,
+		float *restrict buf, uint32_t buf_len,
+		const float *restrict mulbuf);
+
 void SAU_Ramp_reset(SAU_Ramp *restrict o);
 void SAU_Ramp_copy(SAU_Ramp *restrict o,
-		const SAU_Ramp *restrict src);
+		const SAU_Ramp *restrict src, uint32_t srate);
 
 bool SAU_Ramp_run(SAU_Ramp *restrict o, uint32_t *restrict pos,
-		float *restrict buf, uint32_t buf_len, uint32_t srate,
+		float *restrict buf, uint32_t buf_len,
+		const float *restrict mulbuf);
+bool SAU_Ramp_run_ctl(SAU_Ramp *restrict o, uint32_t *restrict pos,
+		float *restrict buf, uint32_t buf_len,
 		const float *restrict mulbuf);
 bool SAU_Ramp_skip(SAU_Ramp *restrict o, uint32_t *restrict pos,
-		uint32_t skip_len, uint32_t srate);
+		uint32_t skip_len);
+
+void SAU_global_init_Ramp(void);
@@ -0,0 +1,148 @@
+/* saugns: Value ramp x86 SIMD support.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * SSE2 (4 values per step) and AVX2 (8 values per step) versions of
+ * the fill loops, compiled for their targets using attributes and
+ * picked at run time. Remaining values use the plain C loop.
+ *
+ * The positions are stepped as integers and converted like in the
+ * plain C loop, and the arithmetic is the same, so that the output
+ * matches it bit-for-bit (provided that no FMA contraction happens).
+ * The conversions are signed, so they're only used for positions
+ * within the first 2^31 of a ramp.
+ */
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+/*
+ * SSE2 version.
+ */
+
+static sauAlwaysInline TARGET_SSE2 __m128 sd_curve_sse2(__m128 x) {
+	__m128 xp2 = _mm_mul_ps(x, x),
+		xp3 = _mm_mul_ps(xp2, x);
+	return _mm_add_ps(xp3, _mm_mul_ps(
+			_mm_sub_ps(_mm_mul_ps(xp2, xp3), xp2),
+			_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(629.f/1792.f)),
+				_mm_mul_ps(xp2, _mm_set1_ps(1163.f/1792.f)))));
+}
+
+/*
+ * \return number of values filled
+ */
+static sauAlwaysInline TARGET_SSE2 uint32_t fill_sse2_body(
+		float *restrict buf, uint32_t len,
+		float v0, float vt, int32_t pos,
+		float inv_time, const float *restrict mulbuf, int type) {
+	const __m128 v_inv_time = _mm_set1_ps(inv_time);
+	const __m128 v_v0 = _mm_set1_ps(v0), v_vt = _mm_set1_ps(vt);
+	const __m128 diff = (type == SAU_RAMP_ESD) ?
+		_mm_set1_ps(v0 - vt) :
+		_mm_set1_ps(vt - v0);
+	__m128i i_pos = _mm_add_epi32(_mm_set1_epi32(pos),
+			_mm_setr_epi32(0, 1, 2, 3));
+	uint32_t i, end = len & ~3U;
+	for (i = 0; i < end; i += 4) {
+		__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(i_pos), v_inv_time);
+		__m128 v;
+		i_pos = _mm_add_epi32(i_pos, _mm_set1_epi32(4));
+		if (type == SAU_RAMP_ESD)
+			v = _mm_add_ps(v_vt, _mm_mul_ps(diff, sd_curve_sse2(
+					_mm_sub_ps(_mm_set1_ps(1.f), x))));
+		else if (type == SAU_RAMP_LSD)
+			v = _mm_add_ps(v_v0, _mm_mul_ps(diff,
+					sd_curve_sse2(x)));
+		else
+			v = _mm_add_ps(v_v0, _mm_mul_ps(diff, x));
+		if (mulbuf != NULL)
+			v = _mm_mul_ps(v, _mm_loadu_ps(&mulbuf[i]));
+		_mm_storeu_ps(&buf[i], v);
+	}
+	return end;
+}
+
+DEF_FILL_CURVES(fill_sse2, TARGET_SSE2, fill_sse2_body)
+
+/*
+ * AVX2 version.
+ */
+
+static sauAlwaysInline TARGET_AVX2 __m256 sd_curve_avx2(__m256 x) {
+	__m256 xp2 = _mm256_mul_ps(x, x),
+		xp3 = _mm256_mul_ps(xp2, x);
+	return _mm256_add_ps(xp3, _mm256_mul_ps(
+			_mm256_sub_ps(_mm256_mul_ps(xp2, xp3), xp2),
+			_mm256_add_ps(
+				_mm256_mul_ps(x,
+					_mm256_set1_ps(629.f/1792.f)),
+				_mm256_mul_ps(xp2,
+					_mm256_set1_ps(1163.f/1792.f)))));
+}
+
+/*
+ * \return number of values filled
+ */
+static sauAlwaysInline TARGET_AVX2 uint32_t fill_avx2_body(
+		float *restrict buf, uint32_t len,
+		float v0, float vt, int32_t pos,
+		float inv_time, const float *restrict mulbuf, int type) {
+	const __m256 v_inv_time = _mm256_set1_ps(inv_time);
+	const __m256 v_v0 = _mm256_set1_ps(v0), v_vt = _mm256_set1_ps(vt);
+	const __m256 diff = (type == SAU_RAMP_ESD) ?
+		_mm256_set1_ps(v0 - vt) :
+		_mm256_set1_ps(vt - v0);
+	__m256i i_pos = _mm256_add_epi32(_mm256_set1_epi32(pos),
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	uint32_t i, end = len & ~7U;
+	for (i = 0; i < end; i += 8) {
+		__m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(i_pos),
+				v_inv_time);
+		__m256 v;
+		i_pos = _mm256_add_epi32(i_pos, _mm256_set1_epi32(8));
+		if (type == SAU_RAMP_ESD)
+			v = _mm256_add_ps(v_vt, _mm256_mul_ps(diff,
+					sd_curve_avx2(_mm256_sub_ps(
+						_mm256_set1_ps(1.f), x))));
+		else if (type == SAU_RAMP_LSD)
+			v = _mm256_add_ps(v_v0, _mm256_mul_ps(diff,
+					sd_curve_avx2(x)));
+		else
+			v = _mm256_add_ps(v_v0, _mm256_mul_ps(diff, x));
+		if (mulbuf != NULL)
+			v = _mm256_mul_ps(v, _mm256_loadu_ps(&mulbuf[i]));
+		_mm256_storeu_ps(&buf[i], v);
+	}
+	return end;
+}
+
+DEF_FILL_CURVES(fill_avx2, TARGET_AVX2, fill_avx2_body)
+
+/*
+ * Pick the best versions supported by the CPU.
+ */
+static void init_x86(void) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		fill_fs = fill_avx2_fs;
+	} else if (__builtin_cpu_supports("sse2")) {
+		fill_fs = fill_sse2_fs;
+	}
+}
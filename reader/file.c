@@ -64,6 +64,7 @@ void SAU_File_init(SAU_File *restrict o,
 	o->ref = ref;
 	o->path = path;
 	o->close_f = close_f;
+	o->hash = NULL;
 }
 
 /**
@@ -223,6 +224,8 @@ static size_t mode_fread(SAU_File *restrict o) {
 	// Move to and fill at the first character of the buffer area.
 	o->pos &= (SAU_FILE_BUFSIZ - 1) & ~(SAU_FILE_ALEN - 1);
 	len = fread(&o->buf[o->pos], 1, SAU_FILE_ALEN, f);
+	if (o->hash != NULL)
+		*o->hash = SAU_hash_fnv1a(*o->hash, &o->buf[o->pos], len);
 	o->call_pos = (o->pos + len) & (SAU_FILE_BUFSIZ - 1);
 	if (len < SAU_FILE_ALEN) SAU_File_end(o, len, ferror(f) != 0);
 	return len;
@@ -254,6 +257,8 @@ static size_t mode_strread(SAU_File *restrict o) {
 		SAU_File_end(o, len, false);
 	}
 	memcpy(&o->buf[o->pos], str, len);
+	if (o->hash != NULL)
+		*o->hash = SAU_hash_fnv1a(*o->hash, str, len);
 	return len;
 }
 
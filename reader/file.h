@@ -171,6 +171,7 @@ struct SAU_File {
 	const char *path;
 	SAU_File *parent;
 	SAU_FileClose_f close_f;
+	uint64_t *hash; // if not NULL, FNV-1a hash updated upon reading
 	uint8_t buf[SAU_FILE_BUFSIZ];
 };
 
@@ -459,12 +459,14 @@ static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 
 /**
  * Create script data for the given script. Invokes the parser.
+ * If \p hash is not NULL, it's set to a hash of the script text.
  *
  * \return instance or NULL on error
  */
-SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path) {
+SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path,
+		uint64_t *restrict hash) {
 	ParseConv pc = (ParseConv){0};
-	SAU_Parse *p = SAU_create_Parse(script_arg, is_path);
+	SAU_Parse *p = SAU_create_Parse(script_arg, is_path, hash);
 	if (!p)
 		return NULL;
 	SAU_Script *o = ParseConv_convert(&pc, p);
@@ -940,6 +940,17 @@ static void parse_in_settings(ParseLevel *restrict pl) {
 			if (scan_num(sc, scan_note_const, &sl->sopt.def_freq))
 				sl->sopt.changed |= SAU_SOPT_DEF_FREQ;
 			break;
+		case 'k': {
+			float on;
+			if (scan_num(sc, NULL, &on)) {
+				if ((sl->sopt.changed & SAU_SOPT_CTL_RAMPS) &&
+				    sl->sopt.ctl_ramps != (on != 0.f))
+					SAU_Scanner_warning(sc, NULL,
+"\"k\" applies to the whole program; overriding earlier value");
+				sl->sopt.ctl_ramps = (on != 0.f);
+				sl->sopt.changed |= SAU_SOPT_CTL_RAMPS;
+			}
+			break; }
 		case 'n': {
 			float freq;
 			if (scan_num(sc, NULL, &freq)) {
@@ -1270,35 +1281,48 @@ RETURN:
 }
 
 /*
- * Process file.
+ * Process file. If \p hash is not NULL, it's set to the hash
+ * of the text read, and failure to read all of it is an error.
  *
  * \return name of script, or NULL on error preventing parse
  */
 static const char *parse_file(SAU_Parser *restrict o,
-		const char *restrict script, bool is_path) {
+		const char *restrict script, bool is_path,
+		uint64_t *restrict hash) {
 	SAU_Scanner *sc = o->sc;
 	const char *name;
 	if (!SAU_Scanner_open(sc, script, is_path))
 		return NULL;
+	if (hash != NULL) {
+		*hash = SAU_FNV_OFFSET;
+		sc->f->hash = hash;
+	}
 	parse_level(o, NULL, SAU_POP_CARR, SCOPE_TOP);
 	name = sc->f->path;
+	if (hash != NULL && (SAU_File_STATUS(sc->f) & SAU_FILE_ERROR)) {
+		SAU_error(NULL,
+"couldn't read all of script \"%s\" to hash it", name);
+		name = NULL;
+	}
 	SAU_Scanner_close(sc);
 	return name;
 }
 
 /**
- * Parse a file and return script data.
+ * Parse a file and return script data. If \p hash is not NULL,
+ * it's set to a hash of the script text parsed.
  *
  * \return instance or NULL on error preventing parse
  */
-SAU_Parse* SAU_create_Parse(const char *restrict script_arg, bool is_path) {
+SAU_Parse* SAU_create_Parse(const char *restrict script_arg, bool is_path,
+		uint64_t *restrict hash) {
 	if (!script_arg)
 		return NULL;
 	SAU_Parser pr;
 	if (!init_Parser(&pr))
 		return NULL;
 	SAU_Parse *o = NULL;
-	const char *name = parse_file(&pr, script_arg, is_path);
+	const char *name = parse_file(&pr, script_arg, is_path, hash);
 	if (!name) goto DONE;
 
 	o = SAU_MemPool_alloc(pr.mp, sizeof(SAU_Parse));
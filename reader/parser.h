@@ -112,6 +112,6 @@ typedef struct SAU_Parse {
 	SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Parse;
 
-SAU_Parse *SAU_create_Parse(const char *restrict script_arg, bool is_path)
-	sauMalloclike;
+SAU_Parse *SAU_create_Parse(const char *restrict script_arg, bool is_path,
+		uint64_t *restrict hash) sauMalloclike;
 void SAU_destroy_Parse(SAU_Parse *restrict o);
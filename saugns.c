@@ -41,7 +41,8 @@ static void print_help(const char *restrict topic,
  */
 static void print_usage(bool h_arg, const char *restrict h_type) {
 	fputs(
-"Usage: "NAME" [-a|-m] [-r <srate>] [-o <wavfile>] [options] <script>...\n"
+"Usage: "NAME" [-a|-m] [-r <srate>] [-o <wavfile>] [-b] [-k] [-j <n>]\n"
+"              [-s <n>] [-t <start>[:<end>]] [-C <sec>] [options] <script>...\n"
 "       "NAME" [-c] [options] <script>...\n"
 "Common options: [-e] [-p]\n",
 		stderr);
@@ -56,6 +57,19 @@ static void print_usage(bool h_arg, const char *restrict h_type) {
 "     \tif unsupported for audio device, warns and prints rate used instead.\n"
 "  -o \tWrite a 16-bit PCM WAV file, always using the sample rate requested;\n"
 "     \tdisables audio device output by default.\n"
+"  -b \tGenerate \"sqr\", \"saw\" and \"tri\" waves analytically,\n"
+"     \tband-limited using PolyBLEP, instead of using wave tables.\n"
+"  -k \tFill parameter ramps with curves at control rate where possible,\n"
+"     \tinterpolating linearly between points with a bounded error.\n"
+"  -j \tRun voices using <n> threads (default 1); the output is the same\n"
+"     \tfor any number.\n"
+"  -s \tRender WAV file output as <n> time segments in parallel (default 1),\n"
+"     \twhen audio device output is disabled; the output is the same.\n"
+"  -t \tPlay only from <start> until <end> (if given), in seconds;\n"
+"     \tskips ahead to the start, giving the same output as when played.\n"
+"  -C \tWrite a checkpoint every <sec> seconds along with the WAV file,\n"
+"     \tto the file named after it with \".ckpt\" added; if it exists,\n"
+"     \tresume from it instead of starting over. Removed once done.\n"
 "  -e \tEvaluate strings instead of files.\n"
 "  -c \tCheck scripts only, reporting any errors or requested info.\n"
 "  -p \tPrint info for scripts after loading.\n"
@@ -92,6 +106,48 @@ static int32_t get_piarg(const char *restrict str) {
 	return i;
 }
 
+/*
+ * Read a time in seconds from the given string, converting to ms.
+ * Stops at \p endc if not at the end of the string.
+ *
+ * \return true if valid, with the time and string end set
+ */
+static bool get_timearg(const char *restrict str, char endc,
+		uint32_t *restrict ms, const char **restrict endp) {
+	char *end;
+	double t;
+	errno = 0;
+	t = strtod(str, &end);
+	if (errno || end == str || !(t >= 0.0) || t * 1000.0 > UINT32_MAX)
+		return false;
+	if (*end != '\0' && *end != endc)
+		return false;
+	*ms = (uint32_t) (t * 1000.0 + 0.5);
+	*endp = end;
+	return true;
+}
+
+/*
+ * Read a time range "<start>[:<end>]" in seconds from the given
+ * string, converting to ms. The end is set to 0 if not given.
+ *
+ * \return true if valid
+ */
+static bool get_rangearg(const char *restrict str,
+		uint32_t *restrict start_ms, uint32_t *restrict end_ms) {
+	const char *endp;
+	if (!get_timearg(str, ':', start_ms, &endp))
+		return false;
+	*end_ms = 0;
+	if (*endp == ':') {
+		if (!get_timearg(endp + 1, '\0', end_ms, &endp))
+			return false;
+		if (*end_ms <= *start_ms)
+			return false;
+	}
+	return true;
+}
+
 /*
  * Parse command line arguments.
  *
@@ -103,17 +159,28 @@ static bool parse_args(int argc, char **restrict argv,
 		uint32_t *restrict flags,
 		SAU_PtrArr *restrict script_args,
 		const char **restrict wav_path,
-		uint32_t *restrict srate) {
+		uint32_t *restrict srate,
+		uint32_t *restrict threads,
+		uint32_t *restrict segments,
+		uint32_t *restrict start_ms,
+		uint32_t *restrict end_ms,
+		uint32_t *restrict ckpt_ms) {
 	struct SAU_opt opt = (struct SAU_opt){0};
 	int c;
 	int32_t i;
+	const char *endp;
 	bool dashdash = false;
 	bool h_arg = false;
 	const char *h_type = NULL;
 	*srate = SAU_DEFAULT_SRATE;
+	*threads = 1;
+	*segments = 1;
+	*start_ms = 0;
+	*end_ms = 0;
+	*ckpt_ms = 0;
 	opt.err = 1;
 REPARSE:
-	while ((c = SAU_getopt(argc, argv, "amr:o:ecphv", &opt)) != -1) {
+	while ((c = SAU_getopt(argc, argv, "amr:o:bkj:s:t:C:ecphv", &opt)) != -1) {
 		switch (c) {
 		case 'a':
 			if ((*flags & (SAU_ARG_AUDIO_DISABLE |
@@ -122,6 +189,50 @@ REPARSE:
 			*flags |= SAU_ARG_MODE_FULL |
 				SAU_ARG_AUDIO_ENABLE;
 			break;
+		case 'b':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL |
+				SAU_ARG_POLYBLEP;
+			break;
+		case 'k':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL |
+				SAU_ARG_CTL_RAMPS;
+			break;
+		case 'j':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL;
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			*threads = i;
+			continue;
+		case 's':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL;
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			*segments = i;
+			continue;
+		case 't':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL;
+			if (!get_rangearg(opt.arg, start_ms, end_ms))
+				goto USAGE;
+			continue;
+		case 'C':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL |
+				SAU_ARG_SCRIPT_HASH;
+			if (!get_timearg(opt.arg, '\0', ckpt_ms, &endp) ||
+					*ckpt_ms == 0)
+				goto USAGE;
+			continue;
 		case 'c':
 			if ((*flags & SAU_ARG_MODE_FULL) != 0)
 				goto USAGE;
@@ -166,6 +277,12 @@ REPARSE:
 			goto ABORT;
 		}
 	}
+	if (*ckpt_ms > 0) {
+		/* checkpoints only for plain rendering to a WAV file */
+		if (!*wav_path || *segments > 1 || *start_ms || *end_ms ||
+				(*flags & SAU_ARG_AUDIO_ENABLE) != 0)
+			goto USAGE;
+	}
 	if (opt.ind > 1 && !strcmp(argv[opt.ind - 1], "--")) dashdash = true;
 	for (;;) {
 		if (opt.ind >= argc || !argv[opt.ind]) {
@@ -195,15 +312,20 @@ int main(int argc, char **restrict argv) {
 	const char *wav_path = NULL;
 	uint32_t options = 0;
 	uint32_t srate = 0;
+	uint32_t threads = 0;
+	uint32_t segments = 0;
+	uint32_t start_ms = 0, end_ms = 0, ckpt_ms = 0;
 	if (!parse_args(argc, argv, &options, &script_args, &wav_path,
-			&srate))
+			&srate, &threads, &segments, &start_ms, &end_ms,
+			&ckpt_ms))
 		return 0;
 	bool error = !SAU_build(&script_args, options, &prg_objs);
 	SAU_PtrArr_clear(&script_args);
 	if (error)
 		return 1;
 	if (prg_objs.count > 0) {
-		error = !SAU_play(&prg_objs, srate, options, wav_path);
+		error = !SAU_play(&prg_objs, srate, threads, segments,
+				start_ms, end_ms, ckpt_ms, options, wav_path);
 		SAU_discard(&prg_objs);
 		if (error)
 			return 1;
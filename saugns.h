@@ -30,6 +30,9 @@ enum {
 	SAU_ARG_MODE_CHECK    = 1<<3,
 	SAU_ARG_PRINT_INFO    = 1<<4,
 	SAU_ARG_EVAL_STRING   = 1<<5,
+	SAU_ARG_POLYBLEP      = 1<<6,
+	SAU_ARG_CTL_RAMPS     = 1<<7,
+	SAU_ARG_SCRIPT_HASH   = 1<<8,
 };
 
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
@@ -37,4 +40,6 @@ size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
 void SAU_discard(SAU_PtrArr *restrict prg_objs);
 
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
+		uint32_t threads, uint32_t segments,
+		uint32_t start_ms, uint32_t end_ms, uint32_t ckpt_ms,
 		uint32_t options, const char *restrict wav_path);
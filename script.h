@@ -87,6 +87,7 @@ enum {
 	SAU_SOPT_DEF_FREQ = 1<<3,
 	SAU_SOPT_DEF_RELFREQ = 1<<4,
 	SAU_SOPT_DEF_CHANMIX = 1<<5,
+	SAU_SOPT_CTL_RAMPS = 1<<6,
 };
 
 /**
@@ -103,6 +104,7 @@ typedef struct SAU_ScriptOptions {
 	float def_freq,
 	      def_relfreq,
 	      def_chanmix;
+	bool ctl_ramps;   // fill ramps at control rate where possible
 } SAU_ScriptOptions;
 
 struct SAU_MemPool;
@@ -117,6 +119,6 @@ typedef struct SAU_Script {
 	struct SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Script;
 
-SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path)
-	sauMalloclike;
+SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path,
+		uint64_t *restrict hash) sauMalloclike;
 void SAU_discard_Script(SAU_Script *restrict o);
@@ -0,0 +1,584 @@
+/* saugns: Test program for interpreter seeking and output.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "saugns.h"
+#include "interp/interp.h"
+#include "math.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define NAME "test-interp"
+
+#define SRATE 48000
+
+/*
+ * Length of each run, not a multiple of the interpreter's
+ * internal block length.
+ */
+#define RUN_LEN 1500
+
+/*
+ * Scripts tested, using FM, PM, AM, ramps and several voices.
+ * The last one is loud enough to clip.
+ */
+static const char *const scripts[] = {
+	"Osin fB3 t.2 p+[Osin r(4/3) Osin f17]\n"
+	";fA4 ;fG5 ;s.3 fA4 t.3 ;fG5 t.1 ;s.1 fA4 t.2 ;fG5 t.1\n",
+	"'a Osin fA4,222~[Osin f211] t1 ;fA3 ;fA2 t2 p+[Osin f112]\n"
+	"Osqr f100,400~[Osin f3] t3 a.5,1~[Osin f2] p+[Osaw r2]\n",
+	"Osin f{cexp v220 t1.5} t1.5 a.3 cL c{v1 t1.5}\n"
+	"\\.4 Otri f330 t1 a.2 ;f660 f{clsd v110 t.5}\n",
+	"S a1\n"
+	"Osqr f200 t1 a.8 Osaw f300 t1 a.8 c{v1 t1} Osin f50 t1\n",
+};
+
+/*
+ * Script with modulators duplicated in lists, the second of each
+ * pair then replaced by the first in test_shared(). Both relative
+ * and absolute frequency, and PM and AM, are used.
+ */
+static const char *const dup_script =
+	"Osin f220 t1.5 p+[Osin r2 a.6 p+[Osin f7] Osin r2 a.6 p+[Osin f7]]"
+	" a.5,1~[Otri f3 Otri f3] ;t.5 f{cexp v440 t.5}\n";
+
+/*
+ * Number of nested modulators in each PM subtree of the
+ * script made by make_deep_script(), enough to run each
+ * subtree as a task with several threads.
+ */
+#define DEEP_LEVELS 10
+
+/*
+ * Thread counts compared against one thread by test_threads().
+ */
+static const uint32_t thread_counts[] = {2, 3, 8};
+
+/*
+ * Script with curves long enough to be filled at control rate,
+ * the "S k" option to be prepended.
+ */
+static const char *const ctl_script =
+	"Osin f{clsd v110 t1} t1 a{cesd v.2 t1} c{cexp v1 t1}\n";
+
+/*
+ * Render program fully from the start, in runs of RUN_LEN samples,
+ * with interpreter \p flags and \p threads.
+ *
+ * \return buffer allocated, with the length set
+ */
+static int16_t *render_with(const SAU_Program *restrict prg,
+		uint32_t flags, uint32_t threads, size_t *restrict len) {
+	SAU_Interp *gen = SAU_create_Interp(prg, SRATE, flags, threads);
+	if (!gen)
+		return NULL;
+	size_t asize = RUN_LEN * 64, pos = 0;
+	int16_t *buf = malloc(asize * 2 * sizeof(int16_t));
+	for (;;) {
+		if (!buf) break;
+		if (pos + RUN_LEN > asize) {
+			asize *= 2;
+			int16_t *new_buf = realloc(buf,
+					asize * 2 * sizeof(int16_t));
+			if (!new_buf) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = new_buf;
+		}
+		size_t run_len = SAU_Interp_run(gen, &buf[pos * 2], RUN_LEN);
+		pos += run_len;
+		if (run_len < RUN_LEN) break;
+	}
+	SAU_destroy_Interp(gen);
+	*len = pos;
+	return buf;
+}
+
+/*
+ * Render program fully from the start, using defaults.
+ *
+ * \return buffer allocated, with the length set
+ */
+static int16_t *render(const SAU_Program *restrict prg,
+		size_t *restrict len) {
+	return render_with(prg, 0, 1, len);
+}
+
+/*
+ * Check that output after seeking, back and ahead, using a
+ * snapshot index of \p max_size bytes, matches \p ref.
+ *
+ * \return true if all the same
+ */
+static bool test_seek(const SAU_Program *restrict prg,
+		const int16_t *restrict ref, size_t ref_len,
+		size_t max_size) {
+	static int16_t buf[RUN_LEN * 2];
+	SAU_Interp *gen = SAU_create_Interp(prg, SRATE, 0, 1);
+	if (!gen)
+		return false;
+	bool ok = SAU_Interp_set_index(gen, 100, max_size);
+	/* record snapshots for the whole signal first */
+	if (ok && SAU_Interp_seek(gen, SIZE_MAX, RUN_LEN) != ref_len)
+		ok = false;
+	size_t runs = ref_len / RUN_LEN;
+	for (uint32_t i = 0; ok && i < 40; ++i) {
+		/* alternate back and ahead */
+		size_t run = (i % 2) ?
+			runs - (i * 7) % (runs + 1) :
+			(i * 13) % (runs + 1);
+		size_t pos = run * RUN_LEN;
+		if (SAU_Interp_seek(gen, pos, RUN_LEN) != pos) {
+			ok = false;
+			break;
+		}
+		for (uint32_t j = 0; j < 3 && pos < ref_len; ++j) {
+			size_t len = SAU_Interp_run(gen, buf, RUN_LEN);
+			size_t ref_run = ref_len - pos;
+			if (ref_run > RUN_LEN) ref_run = RUN_LEN;
+			if (len != ref_run || memcmp(buf, &ref[pos * 2],
+						len * 2 * sizeof(int16_t))) {
+				ok = false;
+				break;
+			}
+			pos += len;
+		}
+	}
+	printf("seek (index %zu bytes)\t%s\n",
+			SAU_Interp_index_size(gen), ok ? "ok" : "FAILED");
+	SAU_destroy_Interp(gen);
+	return ok;
+}
+
+/*
+ * Check that output using several threads, for each count in
+ * thread_counts, matches \p ref (output using one thread).
+ *
+ * \return true if all the same
+ */
+static bool test_threads(const SAU_Program *restrict prg,
+		const int16_t *restrict ref, size_t ref_len) {
+	size_t count = sizeof(thread_counts) / sizeof(*thread_counts);
+	bool ok = true;
+	for (size_t i = 0; i < count; ++i) {
+		size_t len;
+		int16_t *buf = render_with(prg, 0, thread_counts[i], &len);
+		if (!buf || len != ref_len ||
+				memcmp(buf, ref, len * 2 * sizeof(int16_t)))
+			ok = false;
+		free(buf);
+	}
+	printf("threads (2, 3, 8)\t%s\n", ok ? "ok" : "FAILED");
+	return ok;
+}
+
+/*
+ * Check that the interleaved and planar float output are the same,
+ * and match \p ref (16-bit output) after clipping and conversion.
+ * Sets \p clipped to the number of values outside [-1.0, 1.0].
+ *
+ * \return true if all the same
+ */
+static bool test_f32(const SAU_Program *restrict prg,
+		const int16_t *restrict ref, size_t ref_len,
+		size_t *restrict clipped) {
+	static float buf[RUN_LEN * 2], buf_l[RUN_LEN], buf_r[RUN_LEN];
+	SAU_Interp *gen = SAU_create_Interp(prg, SRATE, 0, 1);
+	SAU_Interp *gen_p = SAU_create_Interp(prg, SRATE, 0, 1);
+	bool ok = (gen != NULL && gen_p != NULL);
+	size_t pos = 0;
+	*clipped = 0;
+	while (ok) {
+		size_t len = SAU_Interp_run_f32(gen, buf, RUN_LEN);
+		size_t len_p = SAU_Interp_run_f32_planar(gen_p,
+				buf_l, buf_r, RUN_LEN);
+		if (len != len_p || pos + len > ref_len) {
+			ok = false;
+			break;
+		}
+		for (size_t i = 0; i < RUN_LEN; ++i) {
+			float s[2] = {buf[i * 2], buf[i * 2 + 1]};
+			if (s[0] != buf_l[i] || s[1] != buf_r[i]) {
+				ok = false;
+				break;
+			}
+			if (i >= len) {
+				if (s[0] != 0.f || s[1] != 0.f) ok = false;
+				continue;
+			}
+			for (int ch = 0; ch < 2; ++ch) {
+				float v = s[ch];
+				if (v > 1.f || v < -1.f) ++*clipped;
+				if (v > 1.f) v = 1.f;
+				else if (v < -1.f) v = -1.f;
+				if (lrintf(v * (float) INT16_MAX) !=
+						ref[(pos + i) * 2 + ch])
+					ok = false;
+			}
+		}
+		pos += len;
+		if (len < RUN_LEN) break;
+	}
+	if (pos != ref_len) ok = false;
+	printf("float output (%zu clipped)\t%s\n",
+			*clipped, ok ? "ok" : "FAILED");
+	SAU_destroy_Interp(gen);
+	SAU_destroy_Interp(gen_p);
+	return ok;
+}
+
+/*
+ * Replace the second operator in each list of two in \p prg with
+ * the first, so that a modulator is shared by several users.
+ *
+ * No script syntax yet gives such lists (multiple-operator nodes
+ * are ignored by the reader), so the program data is patched.
+ *
+ * \return number of lists changed
+ */
+static uint32_t share_mods(SAU_Program *restrict prg) {
+	uint32_t count = 0;
+	for (size_t i = 0; i < prg->ev_count; ++i) {
+		const SAU_ProgramEvent *ev = prg->events[i];
+		for (size_t j = 0; j < ev->op_data_count; ++j) {
+			const SAU_ProgramOpData *od = &ev->op_data[j];
+			const SAU_ProgramOpList *lists[] = {
+				od->fmods, od->pmods, od->amods,
+			};
+			for (int k = 0; k < 3; ++k) {
+				SAU_ProgramOpList *list =
+					(SAU_ProgramOpList*) lists[k];
+				/* lists may be pointed to by later events */
+				if (!list || list->count != 2 ||
+						list->ids[1] == list->ids[0])
+					continue;
+				list->ids[1] = list->ids[0];
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+/*
+ * Check that output for \p dup_script is the same when each pair of
+ * modulators is instead one modulator shared by its users, which is
+ * run once per block and its output re-used.
+ *
+ * \return true if the same
+ */
+static bool test_shared(void) {
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	SAU_PtrArr_add(&script_args, (void*) dup_script);
+	SAU_PtrArr_add(&script_args, (void*) dup_script);
+	bool ok = (SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) == 2);
+	SAU_PtrArr_clear(&script_args);
+	SAU_Program **prgs = (SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	int16_t *ref = NULL, *buf = NULL;
+	size_t ref_len = 0, len = 0;
+	if (ok && share_mods(prgs[1]) != 2)
+		ok = false;
+	if (ok) {
+		ref = render(prgs[0], &ref_len);
+		buf = render(prgs[1], &len);
+	}
+	if (!ref || !buf || len != ref_len ||
+			memcmp(buf, ref, len * 2 * sizeof(int16_t)))
+		ok = false;
+	printf("shared modulators, %zu samples\t%s\n",
+			len, ok ? "ok" : "FAILED");
+	free(ref);
+	free(buf);
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/*
+ * Check that an "S k" option in a script overrides the interpreter's
+ * control-rate ramps flag either way, and that the flag and option
+ * make a difference for \p ctl_script.
+ *
+ * \return true if all passed
+ */
+static bool test_ctl(void) {
+	static const char *const sopts[] = {"", "S k0\n", "S k1\n"};
+	char texts[3][128];
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	for (int i = 0; i < 3; ++i) {
+		snprintf(texts[i], sizeof(texts[i]), "%s%s",
+				sopts[i], ctl_script);
+		SAU_PtrArr_add(&script_args, texts[i]);
+	}
+	bool ok = (SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) == 3);
+	SAU_PtrArr_clear(&script_args);
+	const SAU_Program **prgs =
+		(const SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	int16_t *bufs[4] = {0};
+	size_t lens[4] = {0};
+	if (ok) {
+		bufs[0] = render_with(prgs[0], 0, 1, &lens[0]);
+		bufs[1] = render_with(prgs[0],
+				SAU_INTERP_CTL_RAMPS, 1, &lens[1]);
+		/* options set by script, flag the opposite */
+		bufs[2] = render_with(prgs[1],
+				SAU_INTERP_CTL_RAMPS, 1, &lens[2]);
+		bufs[3] = render_with(prgs[2], 0, 1, &lens[3]);
+	}
+	for (int i = 0; i < 4; ++i)
+		if (!bufs[i] || lens[i] != lens[0]) ok = false;
+	size_t size = lens[0] * 2 * sizeof(int16_t);
+	if (ok && (!memcmp(bufs[0], bufs[1], size) ||
+			memcmp(bufs[0], bufs[2], size) ||
+			memcmp(bufs[1], bufs[3], size)))
+		ok = false;
+	printf("control-rate ramps, -k and S k\t%s\n",
+			ok ? "ok" : "FAILED");
+	for (int i = 0; i < 4; ++i)
+		free(bufs[i]);
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/*
+ * Check that the script hash is that of the text given, over
+ * several file buffer areas, and only made if asked for.
+ *
+ * \return true if all passed
+ */
+static bool test_hash(void) {
+	static char text[10000];
+	size_t len = 0;
+	while (len + 40 < sizeof(text))
+		len += sprintf(&text[len], "Osin f%zu t.01\n", 100 + len);
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	SAU_PtrArr_add(&script_args, text);
+	bool ok = (SAU_build(&script_args,
+				SAU_ARG_EVAL_STRING | SAU_ARG_SCRIPT_HASH,
+				&prg_objs) == 1) &&
+		(SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) == 1);
+	SAU_PtrArr_clear(&script_args);
+	SAU_Program **prgs = (SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	if (ok && (prgs[0]->script_hash !=
+			SAU_hash_fnv1a(SAU_FNV_OFFSET, text, len) ||
+			prgs[1]->script_hash != 0))
+		ok = false;
+	printf("script hash, %zu bytes\t%s\n", len, ok ? "ok" : "FAILED");
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/*
+ * Check that output after saving the state part way into \p prg,
+ * with interpreter \p flags, and loading it into a new instance,
+ * matches \p ref (output rendered with the same flags). Also check
+ * that an instance for \p other_prg, which has another operator or
+ * voice count, rejects the state.
+ *
+ * \return true if all passed
+ */
+static bool test_resume(const SAU_Program *restrict prg,
+		const SAU_Program *restrict other_prg, uint32_t flags,
+		const int16_t *restrict ref, size_t ref_len) {
+	static int16_t buf[RUN_LEN * 2];
+	size_t pos = 0, half = ref_len / 2;
+	bool ok = true;
+	FILE *f = tmpfile();
+	if (!f)
+		return false;
+	SAU_Interp *gen = SAU_create_Interp(prg, SRATE, flags, 1);
+	if (!gen)
+		ok = false;
+	while (ok && pos < half)
+		pos += SAU_Interp_run(gen, buf, RUN_LEN);
+	if (ok && !SAU_Interp_save(gen, f))
+		ok = false;
+	SAU_destroy_Interp(gen);
+	rewind(f);
+	gen = ok ? SAU_create_Interp(prg, SRATE, flags, 1) : NULL;
+	if (!gen || !SAU_Interp_load(gen, f))
+		ok = false;
+	while (ok && pos < ref_len) {
+		size_t len = SAU_Interp_run(gen, buf, RUN_LEN);
+		size_t ref_run = ref_len - pos;
+		if (ref_run > RUN_LEN) ref_run = RUN_LEN;
+		if (len != ref_run || memcmp(buf, &ref[pos * 2],
+					len * 2 * sizeof(int16_t)))
+			ok = false;
+		pos += len;
+	}
+	SAU_destroy_Interp(gen);
+	rewind(f);
+	gen = SAU_create_Interp(other_prg, SRATE, flags, 1);
+	if (!gen || SAU_Interp_load(gen, f))
+		ok = false;
+	SAU_destroy_Interp(gen);
+	fclose(f);
+	return ok;
+}
+
+/*
+ * Check resuming from saved state, without and with control-rate
+ * ramps, using the curves of a script from \p scripts. Another
+ * script, with another operator count, is used for
+ * checking that mismatched state is rejected.
+ *
+ * \return true if all passed
+ */
+static bool test_resumes(void) {
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	SAU_PtrArr_add(&script_args, (void*) scripts[2]);
+	SAU_PtrArr_add(&script_args, (void*) scripts[1]);
+	bool ok = (SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) == 2);
+	SAU_PtrArr_clear(&script_args);
+	const SAU_Program **prgs =
+		(const SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	if (ok && prgs[0]->op_count == prgs[1]->op_count &&
+			prgs[0]->vo_count == prgs[1]->vo_count)
+		ok = false;
+	for (int i = 0; ok && i < 2; ++i) {
+		uint32_t flags = i ? SAU_INTERP_CTL_RAMPS : 0;
+		size_t ref_len;
+		int16_t *ref = render_with(prgs[0], flags, 1, &ref_len);
+		if (!ref || !test_resume(prgs[0], prgs[1], flags,
+					ref, ref_len))
+			ok = false;
+		free(ref);
+	}
+	printf("save and load, with and without -k\t%s\n",
+			ok ? "ok" : "FAILED");
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/*
+ * Write a script with two voices, the first with three PM subtrees of
+ * DEEP_LEVELS nested modulators each, to \p buf of \p size bytes.
+ *
+ * \return true unless too long
+ */
+static bool make_deep_script(char *restrict buf, size_t size) {
+	size_t len = snprintf(buf, size, "Osin f110 t1 p+[");
+	for (int i = 0; i < 3 && len < size; ++i) {
+		for (int j = 0; j < DEEP_LEVELS && len < size; ++j)
+			len += snprintf(&buf[len], size - len,
+					"Osin r%d.%d a.4 p+[", j % 3 + 1, i);
+		for (int j = 0; j < DEEP_LEVELS && len < size; ++j)
+			len += snprintf(&buf[len], size - len, "]");
+		if (len < size)
+			len += snprintf(&buf[len], size - len, " ");
+	}
+	if (len < size)
+		len += snprintf(&buf[len], size - len,
+				"]\n\\.5 Osin f220 t1 p+[Osin r2]\n");
+	return len < size;
+}
+
+/*
+ * Check that output is the same for several threads as for one, for
+ * the script from make_deep_script(), which has parallel subtrees.
+ *
+ * \return true if the same
+ */
+static bool test_deep(void) {
+	static char text[2048];
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	bool ok = make_deep_script(text, sizeof(text));
+	SAU_PtrArr_add(&script_args, text);
+	if (ok && SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) != 1)
+		ok = false;
+	SAU_PtrArr_clear(&script_args);
+	const SAU_Program **prgs =
+		(const SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	size_t ref_len = 0;
+	int16_t *ref = ok ? render(prgs[0], &ref_len) : NULL;
+	printf("parallel subtrees, %zu samples\n", ref_len);
+	if (!ref || !test_threads(prgs[0], ref, ref_len))
+		ok = false;
+	free(ref);
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/*
+ * Run tests for each script.
+ *
+ * \return true if all passed
+ */
+static bool test_scripts(void) {
+	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
+	size_t count = sizeof(scripts) / sizeof(*scripts);
+	for (size_t i = 0; i < count; ++i)
+		SAU_PtrArr_add(&script_args, (void*) scripts[i]);
+	bool ok = (SAU_build(&script_args, SAU_ARG_EVAL_STRING,
+				&prg_objs) == count);
+	SAU_PtrArr_clear(&script_args);
+	const SAU_Program **prgs =
+		(const SAU_Program**) SAU_PtrArr_ITEMS(&prg_objs);
+	for (size_t i = 0; ok && i < count; ++i) {
+		size_t ref_len;
+		int16_t *ref = render(prgs[i], &ref_len);
+		if (!ref) {
+			ok = false;
+			break;
+		}
+		printf("script %zu, %zu samples\n", i, ref_len);
+		/* large enough for all, and small enough to thin out */
+		if (!test_seek(prgs[i], ref, ref_len, 1 << 24)) ok = false;
+		if (!test_seek(prgs[i], ref, ref_len, 1 << 13)) ok = false;
+		size_t clipped;
+		if (!test_f32(prgs[i], ref, ref_len, &clipped)) ok = false;
+		if (!test_threads(prgs[i], ref, ref_len)) ok = false;
+		/* the last must exceed 1.0 for clipping to be tested */
+		if (i == count - 1 && !clipped) {
+			puts("no clipping found for last script\tFAILED");
+			ok = false;
+		}
+		free(ref);
+	}
+	SAU_discard(&prg_objs);
+	return ok;
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char **restrict argv) {
+	(void)argv;
+	if (argc > 1) {
+		fputs("Usage: "NAME"\n", stderr);
+		return 0;
+	}
+	bool ok = test_scripts();
+	if (!test_shared()) ok = false;
+	if (!test_deep()) ok = false;
+	if (!test_ctl()) ok = false;
+	if (!test_hash()) ok = false;
+	if (!test_resumes()) ok = false;
+	return ok ? 0 : 1;
+}
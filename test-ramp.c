@@ -0,0 +1,254 @@
+/* saugns: Test program for value ramp fill precision.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ramp.h"
+#include "time.h"
+#include "math.h"
+#include <stdio.h>
+#include <stdlib.h>
+#define NAME "test-ramp"
+
+/*
+ * Largest error allowed, relative to the largest absolute value
+ * of the ramp.
+ */
+#define MAX_REL_ERROR 4e-6
+
+/*
+ * Buffer length, a little longer than the run lengths used,
+ * which vary to exercise the ends of the SIMD loops.
+ */
+#define BUF_LEN 1024
+
+/*
+ * The 'lsd' curve, evaluated per sample the way the ramp module
+ * did it before getting SIMD loops, but in double precision.
+ */
+static double ref_sd_curve(double x) {
+	double xp2 = x * x,
+		xp3 = xp2 * x;
+	return xp3 + (xp2 * xp3 - xp2) *
+		(x * (629.0/1792.0) + xp2 * (1163.0/1792.0));
+}
+
+/*
+ * Get reference value for ramp \p type at position \p pos.
+ */
+static double ref_value(uint8_t type, double v0, double vt,
+		uint32_t pos, uint32_t time) {
+	double x = (double) pos / time;
+	if (type == SAU_RAMP_EXP)
+		type = (v0 > vt) ? SAU_RAMP_ESD : SAU_RAMP_LSD;
+	else if (type == SAU_RAMP_LOG)
+		type = (v0 < vt) ? SAU_RAMP_ESD : SAU_RAMP_LSD;
+	switch (type) {
+	case SAU_RAMP_HOLD:
+		return v0;
+	case SAU_RAMP_LIN:
+		return v0 + (vt - v0) * x;
+	case SAU_RAMP_ESD:
+		return vt + (v0 - vt) * ref_sd_curve(1.0 - x);
+	case SAU_RAMP_LSD:
+		return v0 + (vt - v0) * ref_sd_curve(x);
+	}
+	return 0.0;
+}
+
+/*
+ * Fill ramp of \p type over \p time positions, from \p pos up to
+ * \p end, in runs of varying lengths, and compare against the
+ * reference values.
+ *
+ * \return largest error found, relative to the largest value
+ */
+static double test_ramp(uint8_t type, float v0, float vt,
+		uint32_t time, uint32_t pos, uint32_t end, bool use_mulbuf) {
+	static float buf[BUF_LEN], mulbuf[BUF_LEN];
+	double max_v = fabs(v0) > fabs(vt) ? fabs(v0) : fabs(vt);
+	double max_err = 0.0;
+	uint32_t run = 0;
+	while (pos < end) {
+		uint32_t len = BUF_LEN - (run++ % 19);
+		if (len > end - pos) len = end - pos;
+		for (uint32_t i = 0; i < len; ++i)
+			mulbuf[i] = 0.5f + (float) ((pos + i) % 101) / 100;
+		SAU_Ramp_fill_funcs[type](buf, len, v0, vt, pos, time,
+				use_mulbuf ? mulbuf : NULL);
+		for (uint32_t i = 0; i < len; ++i) {
+			double ref = ref_value(type, v0, vt, pos + i, time);
+			if (use_mulbuf) ref *= mulbuf[i];
+			double err = fabs(buf[i] - ref) / max_v;
+			if (err > max_err) max_err = err;
+		}
+		pos += len;
+	}
+	return max_err;
+}
+
+/*
+ * Length of the longest ramp tested, about 9 hours at 96 kHz,
+ * and length of the parts of it filled, around the middle and
+ * the end. The middle part crosses 2^31 positions.
+ */
+#define LONG_TIME  (3U << 30)
+#define LONG_RANGE (BUF_LEN * 64)
+
+/*
+ * Test ramp of each type for some value pairs and lengths, the
+ * longest being 3 minutes at 96 kHz (with positions beyond those
+ * exact in single precision), and print the largest errors. Also
+ * fill parts of a ramp over 2^31 positions long.
+ *
+ * \return true if all within MAX_REL_ERROR
+ */
+static bool test_ramps(void) {
+	static const float values[][2] = {
+		{0.f, 1.f},
+		{1.f, 0.f},
+		{20.f, 20000.f},
+		{-3.f, 0.25f},
+	};
+	static const uint32_t times[] = {
+		1,
+		37,
+		48000,
+		96000 * 180,
+	};
+	const size_t values_count = sizeof(values) / sizeof(*values);
+	const size_t times_count = sizeof(times) / sizeof(*times);
+	bool ok = true;
+	for (uint8_t type = 0; type < SAU_RAMP_TYPES; ++type) {
+		double max_err = 0.0;
+		for (size_t i = 0; i < values_count; ++i)
+		for (size_t j = 0; j < times_count; ++j)
+		for (int m = 0; m < 2; ++m) {
+			double err = test_ramp(type,
+					values[i][0], values[i][1],
+					times[j], 0, times[j], m);
+			if (err > max_err) max_err = err;
+		}
+		for (size_t i = 0; i < values_count; ++i)
+		for (int m = 0; m < 2; ++m) {
+			const uint32_t starts[] = {
+				(1U << 31) - LONG_RANGE / 2,
+				LONG_TIME - LONG_RANGE,
+			};
+			for (size_t k = 0; k < 2; ++k) {
+				double err = test_ramp(type,
+						values[i][0], values[i][1],
+						LONG_TIME, starts[k],
+						starts[k] + LONG_RANGE, m);
+				if (err > max_err) max_err = err;
+			}
+		}
+		bool type_ok = (max_err <= MAX_REL_ERROR);
+		printf("%s\tmax. relative error %.3g\t%s\n",
+				SAU_Ramp_names[type], max_err,
+				type_ok ? "ok" : "FAILED");
+		if (!type_ok) ok = false;
+	}
+	return ok;
+}
+
+/*
+ * Run ramp of \p type over \p time_ms at \p srate, at control rate,
+ * in runs of varying lengths, and compare against the reference values.
+ *
+ * \return largest error found, relative to the difference between values
+ */
+static double test_ctl_ramp(uint8_t type, float v0, float vt,
+		uint32_t time_ms, uint32_t srate) {
+	static float buf[BUF_LEN];
+	const SAU_Ramp src = {.v0 = v0, .vt = vt, .time_ms = time_ms,
+		.type = type, .flags = SAU_RAMPP_STATE | SAU_RAMPP_GOAL};
+	SAU_Ramp ramp;
+	SAU_Ramp_reset(&ramp);
+	SAU_Ramp_copy(&ramp, &src, srate);
+	uint32_t time = ramp.time;
+	double diff = fabs(vt - v0);
+	double max_err = 0.0;
+	uint32_t pos = 0, run = 0;
+	while (pos < time) {
+		uint32_t start = pos;
+		uint32_t len = BUF_LEN - (run++ % 19);
+		if (len > time - pos) len = time - pos;
+		SAU_Ramp_run_ctl(&ramp, &pos, buf, len, NULL);
+		for (uint32_t i = 0; i < len; ++i) {
+			double ref = ref_value(type, v0, vt, start + i, time);
+			double err = fabs(buf[i] - ref) / diff;
+			if (err > max_err) max_err = err;
+		}
+	}
+	return max_err;
+}
+
+/*
+ * Test control-rate filling of each curve type for some value pairs
+ * and lengths, and print the largest errors.
+ *
+ * \return true if all within SAU_Ramp_CTL_MAX_ERROR (plus MAX_REL_ERROR)
+ */
+static bool test_ctl_ramps(void) {
+	static const float values[][2] = {
+		{0.f, 1.f},
+		{1.f, 0.f},
+		{20.f, 20000.f},
+		{-3.f, 0.25f},
+	};
+	static const uint32_t times_ms[] = {
+		1,
+		10,
+		100,
+		1000,
+		180000,
+	};
+	const size_t values_count = sizeof(values) / sizeof(*values);
+	const size_t times_count = sizeof(times_ms) / sizeof(*times_ms);
+	bool ok = true;
+	for (uint8_t type = SAU_RAMP_EXP; type < SAU_RAMP_TYPES; ++type) {
+		double max_err = 0.0;
+		for (size_t i = 0; i < values_count; ++i)
+		for (size_t j = 0; j < times_count; ++j) {
+			double err = test_ctl_ramp(type,
+					values[i][0], values[i][1],
+					times_ms[j], 96000);
+			if (err > max_err) max_err = err;
+		}
+		bool type_ok = (max_err <=
+				SAU_Ramp_CTL_MAX_ERROR + MAX_REL_ERROR);
+		printf("%s (ctl)\tmax. relative error %.3g\t%s\n",
+				SAU_Ramp_names[type], max_err,
+				type_ok ? "ok" : "FAILED");
+		if (!type_ok) ok = false;
+	}
+	return ok;
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char **restrict argv) {
+	(void)argv;
+	if (argc > 1) {
+		fputs("Usage: "NAME"\n", stderr);
+		return 0;
+	}
+	SAU_global_init_Ramp();
+	bool ok = test_ramps();
+	if (!test_ctl_ramps()) ok = false;
+	return ok ? 0 : 1;
+}
@@ -17,6 +17,15 @@
 
 #pragma once
 #include "common.h"
+#ifndef SAU_WAVE_INT16
+/*
+ * Store LUT values as 16-bit integers instead of floats?
+ *
+ * Enable to halve the size of the LUTs, for less cache use,
+ * at the cost of precision (like that of 16-bit audio).
+ */
+# define SAU_WAVE_INT16 0
+#endif
 
 #define SAU_Wave_LENBITS 11
 #define SAU_Wave_LEN     (1<<SAU_Wave_LENBITS) /* 2048 */
@@ -43,8 +52,40 @@ enum {
 	SAU_WAVE_TYPES
 };
 
-/** LUTs for wave types. */
-extern float SAU_Wave_luts[SAU_WAVE_TYPES][SAU_Wave_LEN];
+/**
+ * Number of LUT levels per wave type. The first is the full wave,
+ * each following level band-limited to half as many harmonics.
+ * (The last has only the fundamental.)
+ */
+#define SAU_Wave_MIPLEVELS SAU_Wave_LENBITS
+
+/**
+ * LUT entry. The value is stored together with the difference
+ * to the next value in the LUT, so that linear interpolation
+ * needs only one lookup.
+ *
+ * With SAU_WAVE_INT16, both are stored as 16-bit integers,
+ * to be multiplied by SAU_Wave_VALSCALE.
+ */
+#if SAU_WAVE_INT16
+typedef struct SAU_WaveVal {
+	int16_t v, d;
+} SAU_WaveVal;
+# define SAU_Wave_VALSCALE (1.f / 16384) /* allows values up to +/- 2.0 */
+#else
+typedef struct SAU_WaveVal {
+	float v, d;
+} SAU_WaveVal;
+# define SAU_Wave_VALSCALE 1.f
+#endif
+
+/**
+ * LUTs for wave types, with each band-limited level. Generated at
+ * build time (by wave/genluts), as read-only data needing no setup.
+ * Levels which would be identical share the same array.
+ */
+extern const SAU_WaveVal *const
+SAU_Wave_luts[SAU_WAVE_TYPES][SAU_Wave_MIPLEVELS];
 
 /** Names of wave types, with an extra NULL pointer at the end. */
 extern const char *const SAU_Wave_names[SAU_WAVE_TYPES + 1];
@@ -60,15 +101,32 @@ extern const char *const SAU_Wave_names[SAU_WAVE_TYPES + 1];
  *
  * \return sample
  */
-static inline float SAU_Wave_get_lerp(const float *restrict lut,
+static inline float SAU_Wave_get_lerp(const SAU_WaveVal *restrict lut,
 		uint32_t phase) {
-	uint32_t ind = SAU_Wave_INDEX(phase);
-	float s = lut[ind];
-	s += (lut[(ind + 1) & SAU_Wave_LENMASK] - s) *
+	const SAU_WaveVal *restrict val = &lut[SAU_Wave_INDEX(phase)];
+	float s = val->v + val->d *
 		((phase & SAU_Wave_SCALEMASK) * (1.f / SAU_Wave_SCALE));
+#if SAU_WAVE_INT16
+	s *= SAU_Wave_VALSCALE;
+#endif
 	return s;
 }
 
-void SAU_global_init_Wave(void);
+/**
+ * Get the LUT level to use for the absolute value of 32-bit phase
+ * increment \p inc, i.e. the first band-limited to keep all harmonics
+ * below the Nyquist frequency.
+ *
+ * \return level
+ */
+static inline uint32_t SAU_Wave_mip_level(uint32_t inc) {
+	uint32_t level = 0;
+	if (inc <= SAU_Wave_SCALE)
+		return 0;
+	for (inc = (inc - 1) >> SAU_Wave_SCALEBITS; inc != 0; inc >>= 1)
+		++level;
+	return (level < SAU_Wave_MIPLEVELS) ?
+		level : (SAU_Wave_MIPLEVELS - 1);
+}
 
 void SAU_Wave_print(uint8_t id);
@@ -0,0 +1,388 @@
+/* saugns: Wave LUT generator.
+ * Copyright (c) 2011-2012, 2017-2020 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Build-time program which computes the wave LUTs, printing them
+ * to stdout as C source for const data (see the Makefile).
+ *
+ * Must be compiled with the same SAU_WAVE_* settings as the rest,
+ * for the same SAU_WaveVal layout.
+ */
+
+#include "../wave.h"
+#include "../math.h"
+#include <stdio.h>
+
+#define HALFLEN (SAU_Wave_LEN>>1)
+
+static SAU_WaveVal luts[SAU_WAVE_TYPES][SAU_Wave_MIPLEVELS][SAU_Wave_LEN];
+
+/*
+ * For each level, the number of the level to use in its place
+ * (the first, if it would differ negligibly), else its own number.
+ */
+static uint8_t lut_refs[SAU_WAVE_TYPES][SAU_Wave_MIPLEVELS];
+
+/*
+ * Replacement tanh-based stEP. Square wave version.
+ *
+ * Replace value range in \p dst with result of
+ * tanh for upscaled values from \p src.
+ *
+ * For use with a sine wave \p src LUT.
+ */
+static void rep_range_sqr(float *restrict dst, const float *restrict src,
+		size_t from, size_t num) {
+	/*
+	 * Twice the scale factor giving the greatest
+	 * aliasing reduction per number of values.
+	 *
+	 * Used with twice the number of values,
+	 * gives a higher-quality result with
+	 * very similar frequency roll-off.
+	 */
+	const float scale = (float) (SAU_Wave_LEN / num);
+	for (size_t i = from, end = from + num; i < end; ++i) {
+		dst[i] = tanhf(src[i] * scale);
+	}
+}
+
+/*
+ * Replacement tanh-based stEP. Sawtooth wave version.
+ *
+ * Replace value range in \p dst with result of
+ * tanh for upscaled values from \p src.
+ *
+ * The sample \p skip number reduces the length, and should
+ * be chosen to begin filling with the lowest >= 0.f value.
+ * This number of samples needs to be zero-filled at the
+ * middle of the sawtooth shape in order for the
+ * anti-aliasing to properly work.
+ *
+ * For use with a sine wave \p src LUT.
+ */
+static void rep_range_saw(float *restrict dst, const float *restrict src,
+		size_t from, size_t num, size_t skip) {
+	/*
+	 * Twice the scale factor giving the greatest
+	 * aliasing reduction per number of values.
+	 *
+	 * Used with twice the number of values,
+	 * gives a higher-quality result with
+	 * very similar frequency roll-off.
+	 *
+	 * Requires inserting an extra zero value
+	 * at the cycle boundary (e.g. beginning).
+	 */
+	const float scale = (float) (SAU_Wave_LEN / num);
+	for (size_t i = from, end = from + num - skip; i < end; ++i) {
+		float s = tanhf(src[i + skip] * scale);
+		dst[i] = -1.f + s*2.f;
+	}
+}
+
+/*
+ * Copy values in reverse direction in \p lut
+ * from first value range to second value range.
+ */
+static void hmirror_range(float *restrict lut,
+		size_t from, size_t num, size_t offs) {
+	for (size_t i = from, end = from + num; i < end; ++i) {
+		lut[offs - i] = lut[i];
+	}
+}
+
+/*
+ * In-place radix-2 FFT of \p len complex values (a power of two),
+ * inverse if \p inv is true (without scaling the result).
+ */
+static void fft(double *restrict re, double *restrict im, size_t len,
+		bool inv) {
+	for (size_t i = 1, j = 0; i < len; ++i) {
+		size_t bit = len >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			double tmp;
+			tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+			tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+		}
+	}
+	for (size_t n = 2; n <= len; n <<= 1) {
+		const double a = (inv ? 2.f : -2.f) * SAU_PI / n;
+		for (size_t i = 0; i < len; i += n) {
+			for (size_t k = 0; k < (n>>1); ++k) {
+				const double w_re = cos(a * k), w_im = sin(a * k);
+				const size_t i0 = i + k, i1 = i0 + (n>>1);
+				double t_re = re[i1] * w_re - im[i1] * w_im;
+				double t_im = re[i1] * w_im + im[i1] * w_re;
+				re[i1] = re[i0] - t_re;
+				im[i1] = im[i0] - t_im;
+				re[i0] += t_re;
+				im[i0] += t_im;
+			}
+		}
+	}
+}
+
+/*
+ * Store the values of \p src into \p dst, each with the difference
+ * to the next value.
+ *
+ * For SAU_WAVE_INT16, the values are rounded first, and the
+ * differences taken between the rounded values.
+ */
+static void set_lut(SAU_WaveVal *restrict dst, const float *restrict src) {
+	for (size_t i = 0; i < SAU_Wave_LEN; ++i) {
+#if SAU_WAVE_INT16
+		int32_t v = lrintf(src[i] * (1.f / SAU_Wave_VALSCALE));
+		int32_t next = lrintf(src[(i + 1) & SAU_Wave_LENMASK] *
+				(1.f / SAU_Wave_VALSCALE));
+		dst[i].v = v;
+		dst[i].d = next - v;
+#else
+		dst[i].v = src[i];
+		dst[i].d = src[(i + 1) & SAU_Wave_LENMASK] - src[i];
+#endif
+	}
+}
+
+/*
+ * Fill in the LUT levels for \p wave from the full wave values \p lut,
+ * the first level as-is, and each following band-limited, removing
+ * harmonics above the number allowed for the level. The upper half
+ * of the harmonics kept is faded out using a raised cosine, to limit
+ * ringing (except if fewer than 4).
+ *
+ * Levels which would differ negligibly (no harmonics removed above
+ * the noise level of float values) are instead marked as identical
+ * to the first, for the first to be reused in their place.
+ */
+static void fill_levels(uint8_t wave, const float *restrict lut) {
+	static double spec_re[SAU_Wave_LEN], spec_im[SAU_Wave_LEN];
+	static double re[SAU_Wave_LEN], im[SAU_Wave_LEN];
+	static float level_lut[SAU_Wave_LEN];
+	SAU_WaveVal (*const levels)[SAU_Wave_LEN] = luts[wave];
+	set_lut(levels[0], lut);
+	for (size_t i = 0; i < SAU_Wave_LEN; ++i) {
+		spec_re[i] = lut[i];
+		spec_im[i] = 0.f;
+	}
+	fft(spec_re, spec_im, SAU_Wave_LEN, false);
+	double max_mag = 0.f;
+	for (size_t k = 0; k <= HALFLEN; ++k) {
+		double mag = fabs(spec_re[k]) + fabs(spec_im[k]);
+		if (mag > max_mag) max_mag = mag;
+	}
+	for (size_t level = 1; level < SAU_Wave_MIPLEVELS; ++level) {
+		const size_t max_k = HALFLEN >> level;
+		const size_t fade_k = (max_k < 4) ? max_k : (max_k >> 1);
+		double cut_mag = 0.f;
+		for (size_t k = max_k + 1; k <= HALFLEN; ++k) {
+			double mag = fabs(spec_re[k]) + fabs(spec_im[k]);
+			if (mag > cut_mag) cut_mag = mag;
+		}
+		if (cut_mag <= max_mag * 1.e-6) {
+			lut_refs[wave][level] = 0;
+			continue;
+		}
+		lut_refs[wave][level] = level;
+		for (size_t k = 0; k < SAU_Wave_LEN; ++k)
+			re[k] = im[k] = 0.f;
+		re[0] = spec_re[0];
+		for (size_t k = 1; k <= max_k; ++k) {
+			double gain = 1.f;
+			if (k > fade_k)
+				gain = 0.5f * (1.f + cos(SAU_PI *
+						(k - fade_k) / (max_k - fade_k + 1)));
+			re[k] = spec_re[k] * gain;
+			im[k] = spec_im[k] * gain;
+			re[SAU_Wave_LEN - k] = re[k];
+			im[SAU_Wave_LEN - k] = -im[k];
+		}
+		fft(re, im, SAU_Wave_LEN, true);
+		for (size_t i = 0; i < SAU_Wave_LEN; ++i)
+			level_lut[i] = re[i] * (1.f / SAU_Wave_LEN);
+		set_lut(levels[level], level_lut);
+	}
+}
+
+/*
+ * Fill in the look-up tables enumerated by SAU_WAVE_*,
+ * including the band-limited levels of each.
+ */
+static void fill_luts(void) {
+	static float full_luts[SAU_WAVE_TYPES][SAU_Wave_LEN];
+	float *const sin_lut = full_luts[SAU_WAVE_SIN];
+	float *const sqr_lut = full_luts[SAU_WAVE_SQR];
+	float *const tri_lut = full_luts[SAU_WAVE_TRI];
+	float *const saw_lut = full_luts[SAU_WAVE_SAW];
+	float *const sha_lut = full_luts[SAU_WAVE_SHA];
+	float *const szh_lut = full_luts[SAU_WAVE_SZH];
+	float *const ssr_lut = full_luts[SAU_WAVE_SSR];
+	int i;
+	const double val_scale = SAU_Wave_MAXVAL;
+	const double len_scale = 1.f / HALFLEN;
+	/*
+	 * First half:
+	 *  - sin
+	 *  - sqr (fill only)
+	 *  - tri
+	 *  - ssr
+	 */
+	for (i = 0; i < HALFLEN; ++i) {
+		const double x = i * len_scale;
+		const double x_rev = (HALFLEN-i) * len_scale;
+
+		const double sin_x = sin(SAU_PI * x);
+		sin_lut[i] = val_scale * sin_x;
+
+		sqr_lut[i] = SAU_Wave_MAXVAL;
+
+		if (i < (HALFLEN>>1))
+			tri_lut[i] = val_scale * 2.f * x;
+		else
+			tri_lut[i] = val_scale * 2.f * x_rev;
+
+		ssr_lut[i] = val_scale * sqrtf(sin_x);
+	}
+	/*
+	 * Replacement tanh-based stEP. (An experimental example
+	 * of the LUT-value-fiddling approach to anti-aliasing.)
+	 *
+	 * Replace ideal step function with tanh-of-sin values.
+	 * Tuned for nice anti-aliasing at mid frequencies, and
+	 * a "nice", yet not too dull sound at low frequencies.
+	 * (The "saw" version zeroes some values at the center,
+	 * though one zero value is displaced to the beginning.)
+	 *
+	 * REP and first half:
+	 *  - sqr (rep only)
+	 *  - saw
+	 */
+	const int rsqr_len = HALFLEN/32;
+	rep_range_sqr(sqr_lut, sin_lut, 0, rsqr_len);
+	hmirror_range(sqr_lut, 0, rsqr_len, HALFLEN);
+	const int rsaw_len = HALFLEN/16;
+	const double saw_scale = 1.f / (HALFLEN - rsaw_len);
+	const int saw_skip = 6; // Pick to start with lowest >= 0.f amplitude
+	// The skipped saw_lut values are == 0.f
+	rep_range_saw(saw_lut+1, sin_lut, 0, rsaw_len, saw_skip);
+	for (i = rsaw_len; i < HALFLEN; ++i) {
+		const double x = (i - rsaw_len) * saw_scale;
+
+		saw_lut[i+1 - saw_skip] = SAU_Wave_MAXVAL - x;
+	}
+	/* Second half:
+	 *  - sin
+	 *  - sqr
+	 *  - tri
+	 *  - saw
+	 *  - ssr
+	 */
+	for (; i < SAU_Wave_LEN; ++i) {
+		sin_lut[i] = -sin_lut[i - HALFLEN];
+
+		sqr_lut[i] = -sqr_lut[i - HALFLEN];
+
+		tri_lut[i] = -tri_lut[i - HALFLEN];
+
+		saw_lut[i] = -saw_lut[(SAU_Wave_LEN-1) - (i-1)];
+
+		ssr_lut[i] = -ssr_lut[i - HALFLEN];
+	}
+	/* Full cycle:
+	 *  - sha
+	 *  - szh
+	 */
+	for (i = 0; i < SAU_Wave_LEN; ++i) {
+		const double x = i * len_scale;
+
+		double sha_x = sin((SAU_PI * x) * 0.5f + SAU_ASIN_1_2);
+		sha_x = fabs(sha_x) - 0.5f;
+		sha_x += sha_x;
+		sha_lut[i] = val_scale * sha_x;
+
+		double szh_x = sin((SAU_PI * x) + SAU_ASIN_1_2);
+		if (szh_x > 0.f) {
+			szh_x -= 0.5f;
+			szh_x += szh_x;
+			szh_lut[i] = val_scale * szh_x;
+		} else {
+			szh_lut[i] = -SAU_Wave_MAXVAL;
+		}
+	}
+	for (i = 0; i < SAU_WAVE_TYPES; ++i)
+		fill_levels(i, full_luts[i]);
+}
+
+/*
+ * Print \p val as a C constant which converts back exactly.
+ */
+static void print_val(float val) {
+#if SAU_WAVE_INT16
+	fprintf(stdout, "%d", (int) val);
+#else
+	fprintf(stdout, "%af", val);
+#endif
+}
+
+/*
+ * Print each distinct LUT level as a const array, followed
+ * by the table of LUT level pointers declared in wave.h.
+ */
+static void print_luts(void) {
+	fputs("/* Generated by wave/genluts; do not edit. */\n"
+		"\n"
+		"#include \"../wave.h\"\n", stdout);
+	for (int wave = 0; wave < SAU_WAVE_TYPES; ++wave) {
+		for (int level = 0; level < SAU_Wave_MIPLEVELS; ++level) {
+			if (lut_refs[wave][level] != level)
+				continue;
+			const SAU_WaveVal *lut = luts[wave][level];
+			fprintf(stdout, "\nstatic const SAU_WaveVal lut%d_%d[] = {\n",
+					wave, level);
+			for (int i = 0; i < SAU_Wave_LEN; ++i) {
+				fputs("\t{", stdout);
+				print_val(lut[i].v);
+				fputs(", ", stdout);
+				print_val(lut[i].d);
+				fputs("},\n", stdout);
+			}
+			fputs("};\n", stdout);
+		}
+	}
+	fputs("\nconst SAU_WaveVal *const\n"
+		"SAU_Wave_luts[SAU_WAVE_TYPES][SAU_Wave_MIPLEVELS] = {\n",
+		stdout);
+	for (int wave = 0; wave < SAU_WAVE_TYPES; ++wave) {
+		fputs("\t{", stdout);
+		for (int level = 0; level < SAU_Wave_MIPLEVELS; ++level) {
+			fprintf(stdout, (level > 0) ? ", lut%d_%d" : "lut%d_%d",
+					wave, lut_refs[wave][level]);
+		}
+		fputs("},\n", stdout);
+	}
+	fputs("};\n", stdout);
+}
+
+int main(void) {
+	fill_luts();
+	print_luts();
+	return 0;
+}